@@ -1,13 +1,13 @@
-QT += quick widgets
-CONFIG += c++11
+TEMPLATE = subdirs
 
-SOURCES += \
-    asemantools.cpp \
-    datafetcher.cpp \
-    main.cpp
+SUBDIRS += \
+    core \
+    gui \
+    cli \
+    bench \
+    tests
 
-RESOURCES += qml.qrc
-
-HEADERS += \
-    asemantools.h \
-    datafetcher.h
+gui.depends = core
+cli.depends = core
+bench.depends = core
+tests.depends = core
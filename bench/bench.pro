@@ -0,0 +1,10 @@
+TARGET = tganalizer-bench
+QT = core testlib
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+include(../core/core.pri)
+include(../testsupport/testsupport.pri)
+
+SOURCES += \
+    benchmark.cpp
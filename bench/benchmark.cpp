@@ -0,0 +1,336 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QMutex>
+
+#include "datafetcher.h"
+#include "corpusgenerator.h"
+
+/*
+ * Scaling benchmarks of the training and classification phases on
+ * generated corpora. The corpus shape is read from the environment:
+ *
+ *   TGANALIZER_BENCH_FILES         comma separated sizes, default 10,100,1000,10000
+ *   TGANALIZER_BENCH_LABELS        default 4
+ *   TGANALIZER_BENCH_MONTHS        default 12
+ *   TGANALIZER_BENCH_PROPERTIES    default 50
+ *   TGANALIZER_BENCH_DISTRIBUTION  uniform, normal (default) or exponential
+ *
+ * Every phase prints its throughput and the peak resident memory reached
+ * while it ran (Linux only, where the peak can be reset).
+ */
+class DataFetcherBenchmark : public QObject
+{
+    Q_OBJECT
+
+    class Corpus
+    {
+    public:
+        QTemporaryDir dir;
+        QTemporaryDir modelDir; // Kept apart, so it is never read as a training file
+        QString model;
+        qint64 bytes = 0;
+        qint32 files = 0;
+    };
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void train_data();
+    void train();
+
+    void snapshot_data();
+    void snapshot();
+
+    void check_data();
+    void check();
+
+    void classify_data();
+    void classify();
+
+private:
+    void addRows();
+    QSharedPointer<Corpus> corpus(qint32 files);
+
+    static void resetPeakMemory();
+    static qreal peakMemory();
+    static void report(const QString &phase, qint64 nsecs, qreal items, const QString &unit, qint64 bytes = 0);
+
+    CorpusGenerator generator;
+    QList<qint32> sizes;
+    QHash<qint32, QSharedPointer<Corpus> > corpora;
+};
+
+void DataFetcherBenchmark::initTestCase()
+{
+    auto env = [](const char *name, qint32 def) {
+        bool ok = false;
+        const qint32 res = qEnvironmentVariableIntValue(name, &ok);
+        return ok? res : def;
+    };
+
+    generator.labels = env("TGANALIZER_BENCH_LABELS", generator.labels);
+    generator.months = env("TGANALIZER_BENCH_MONTHS", generator.months);
+    generator.properties = env("TGANALIZER_BENCH_PROPERTIES", generator.properties);
+
+    const QByteArray distribution = qgetenv("TGANALIZER_BENCH_DISTRIBUTION").toLower();
+    if (distribution == "uniform")
+        generator.distribution = CorpusGenerator::Uniform;
+    else if (distribution == "exponential")
+        generator.distribution = CorpusGenerator::Exponential;
+
+    QByteArray files = qgetenv("TGANALIZER_BENCH_FILES");
+    if (files.isEmpty())
+        files = "10,100,1000,10000";
+    for (const QByteArray &f: files.split(','))
+        if (f.toInt() > 0)
+            sizes << f.toInt();
+}
+
+void DataFetcherBenchmark::addRows()
+{
+    QTest::addColumn<qint32>("files");
+    for (qint32 files: sizes)
+        QTest::newRow(QByteArray::number(files).constData()) << files;
+}
+
+void DataFetcherBenchmark::train_data()
+{
+    QTest::addColumn<qint32>("files");
+    QTest::addColumn<bool>("singlePass");
+    for (qint32 files: sizes)
+    {
+        QTest::newRow(QByteArray::number(files).constData()) << files << false;
+        QTest::newRow((QByteArray::number(files) + " single pass").constData()) << files << true;
+    }
+}
+
+void DataFetcherBenchmark::train()
+{
+    QFETCH(qint32, files);
+    QFETCH(bool, singlePass);
+    QSharedPointer<Corpus> c = corpus(files);
+
+    // The progress signals come from the worker threads, and mark where
+    // parsing ends and binning starts.
+    QMutex mutex;
+    QElapsedTimer timer;
+    qint64 parsed = 0;
+    qint64 binned = -1;
+    qreal statisticsPeak = 0;
+
+    DataFetcher fetcher;
+    fetcher.setSinglePass(singlePass);
+    connect(&fetcher, &DataFetcher::filesParsed, [&](qint32, qint32){
+        QMutexLocker locker(&mutex);
+        parsed = qMax(parsed, timer.nsecsElapsed());
+    });
+    connect(&fetcher, &DataFetcher::propertiesBinned, [&](qint32, qint32){
+        if (binned >= 0)
+            return;
+        binned = timer.nsecsElapsed();
+        statisticsPeak = peakMemory();
+    });
+
+    resetPeakMemory();
+    qint64 total = 0;
+    QBENCHMARK_ONCE {
+        timer.start();
+        fetcher.setSource(c->dir.path());
+        total = timer.nsecsElapsed();
+    }
+
+    if (binned < 0)
+        binned = total;
+
+    report("parse", parsed, files, "files", c->bytes);
+    report("statistics", binned - parsed, files, "files");
+    report("binning", total - binned, files, "files");
+    report("train", total, files, "files", c->bytes);
+    qInfo().noquote() << QString("  peak after statistics %1 MB").arg(statisticsPeak, 0, 'f', 1);
+
+    const QVariantMap stats = fetcher.stats();
+    qInfo().noquote() << QString("  values %1 MB, arena %2 MB, histograms %3 MB").arg(stats.value("valueBytes").toLongLong() / 1048576.0, 0, 'f', 1)
+                                                                              .arg(stats.value("arenaBytes").toLongLong() / 1048576.0, 0, 'f', 1)
+                                                                              .arg(stats.value("histogramBytes").toLongLong() / 1048576.0, 0, 'f', 1);
+    if (stats.contains("allocations"))
+        qInfo().noquote() << QString("  %1 heap allocations").arg(stats.value("allocations").toLongLong());
+
+    QVERIFY(fetcher.labels().count() == generator.labels);
+}
+
+void DataFetcherBenchmark::snapshot_data()
+{
+    addRows();
+}
+
+void DataFetcherBenchmark::snapshot()
+{
+    QFETCH(qint32, files);
+    QSharedPointer<Corpus> c = corpus(files);
+
+    DataFetcher fetcher;
+    resetPeakMemory();
+    QElapsedTimer timer;
+    QBENCHMARK_ONCE {
+        timer.start();
+        QVERIFY(fetcher.loadModel(c->model));
+    }
+    report("snapshot load", timer.nsecsElapsed(), QFileInfo(c->model).size() / 1048576.0, "MB");
+}
+
+void DataFetcherBenchmark::check_data()
+{
+    QTest::addColumn<qint32>("files");
+    QTest::addColumn<bool>("cached");
+    for (qint32 files: sizes)
+    {
+        QTest::newRow(QByteArray::number(files).constData()) << files << false;
+        QTest::newRow((QByteArray::number(files) + " cached").constData()) << files << true;
+    }
+}
+
+void DataFetcherBenchmark::check()
+{
+    QFETCH(qint32, files);
+    QFETCH(bool, cached);
+    QSharedPointer<Corpus> c = corpus(files);
+
+    // The same file every time, so with the cache on all but the first
+    // check are hits.
+    DataFetcher fetcher;
+    if (!cached)
+        fetcher.setCacheSize(0);
+    QVERIFY(fetcher.loadModel(c->model));
+
+    const QString path = c->dir.filePath(generator.fileName(0));
+    resetPeakMemory();
+
+    qint32 count = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        fetcher.check(path);
+        count++;
+    }
+    report(cached? "cached check" : "check", timer.nsecsElapsed(), count, "checks");
+}
+
+void DataFetcherBenchmark::classify_data()
+{
+    QTest::addColumn<qint32>("files");
+    QTest::addColumn<bool>("linear");
+    for (qint32 files: sizes)
+    {
+        QTest::newRow(QByteArray::number(files).constData()) << files << false;
+        QTest::newRow((QByteArray::number(files) + " linear").constData()) << files << true;
+    }
+}
+
+void DataFetcherBenchmark::classify()
+{
+    QFETCH(qint32, files);
+    QFETCH(bool, linear);
+    QSharedPointer<Corpus> c = corpus(files);
+
+    DataFetcher fetcher;
+    fetcher.setScorer(linear? DataFetcher::LinearScorer : DataFetcher::SmoothScorer);
+    QVERIFY(fetcher.loadModel(c->model));
+
+    resetPeakMemory();
+    qint32 count = 0;
+    QElapsedTimer timer;
+    QBENCHMARK_ONCE {
+        timer.start();
+        count = fetcher.classify({c->dir.path()});
+    }
+    report("classify", timer.nsecsElapsed(), count, "files", c->bytes);
+    QCOMPARE(count, files);
+}
+
+QSharedPointer<DataFetcherBenchmark::Corpus> DataFetcherBenchmark::corpus(qint32 files)
+{
+    QSharedPointer<Corpus> res = corpora.value(files);
+    if (res)
+        return res;
+
+    res = QSharedPointer<Corpus>(new Corpus);
+    res->files = files;
+
+    CorpusGenerator gen = generator;
+    gen.files = files;
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!gen.generate(res->dir.path(), &res->bytes))
+        qFatal("Can't generate the corpus in %s", qPrintable(res->dir.path()));
+    report("generate", timer.nsecsElapsed(), files, "files", res->bytes);
+
+    res->model = res->modelDir.filePath("model.bin");
+    DataFetcher fetcher;
+    fetcher.setSource(res->dir.path());
+    if (!fetcher.saveModel(res->model))
+        qFatal("Can't write %s", qPrintable(res->model));
+
+    corpora[files] = res;
+    return res;
+}
+
+void DataFetcherBenchmark::resetPeakMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile file("/proc/self/clear_refs");
+    if (file.open(QFile::WriteOnly))
+        file.write("5");
+#endif
+}
+
+qreal DataFetcherBenchmark::peakMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile file("/proc/self/status");
+    if (!file.open(QFile::ReadOnly))
+        return 0;
+
+    for (const QByteArray &line: file.readAll().split('\n'))
+        if (line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong() / 1024.0;
+#endif
+    return 0;
+}
+
+void DataFetcherBenchmark::report(const QString &phase, qint64 nsecs, qreal items, const QString &unit, qint64 bytes)
+{
+    const qreal secs = qMax<qint64>(nsecs, 1) / 1e9;
+    QString line = QString("  %1: %2 ms, %3 %4/s").arg(phase, -14).arg(nsecs / 1e6, 0, 'f', 2)
+                                                 .arg(items / secs, 0, 'f', 1).arg(unit);
+    if (bytes)
+        line += QString(", %1 MB/s").arg(bytes / 1048576.0 / secs, 0, 'f', 1);
+    line += QString(", peak %1 MB").arg(peakMemory(), 0, 'f', 1);
+
+    qInfo().noquote() << line;
+}
+
+QTEST_GUILESS_MAIN(DataFetcherBenchmark)
+
+#include "benchmark.moc"
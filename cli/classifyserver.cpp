@@ -0,0 +1,257 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "classifyserver.h"
+#include "datafetcher.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QtEndian>
+
+#define MAXIMUM_FRAME (16 * 1024 * 1024)
+
+class ClassifyServer::Private
+{
+public:
+    DataFetcher *fetcher;
+    QLocalServer server;
+    QThreadPool pool;
+    QFileSystemWatcher watcher;
+    QTimer reloadTimer;
+    QString modelPath;
+    DataFetcher::Classifier classifier;
+    qint64 requests;
+};
+
+ClassifyServer::ClassifyServer(DataFetcher *fetcher, QObject *parent) :
+    QObject(parent)
+{
+    p = new Private;
+    p->fetcher = fetcher;
+    p->classifier = fetcher->classifier();
+    p->requests = 0;
+    setThreads(fetcher->threads());
+
+    // Snapshots are written to a temporary file and renamed over the old
+    // one, which fires the watcher more than once.
+    p->reloadTimer.setInterval(200);
+    p->reloadTimer.setSingleShot(true);
+
+    connect(&p->server, &QLocalServer::newConnection, this, &ClassifyServer::newConnection);
+    connect(&p->watcher, &QFileSystemWatcher::fileChanged, &p->reloadTimer, static_cast<void(QTimer::*)()>(&QTimer::start));
+    connect(&p->reloadTimer, &QTimer::timeout, this, &ClassifyServer::reload);
+    // Anything the classifier captures makes it stale.
+    auto refresh = [this](){ p->classifier = p->fetcher->classifier(); };
+    connect(fetcher, &DataFetcher::sourceChanged, this, refresh);
+    connect(fetcher, &DataFetcher::scorerChanged, this, refresh);
+    connect(fetcher, &DataFetcher::propertiesChanged, this, refresh);
+    connect(fetcher, &DataFetcher::mergablesChanged, this, refresh);
+    connect(fetcher, &DataFetcher::streamingChanged, this, refresh);
+}
+
+bool ClassifyServer::listen(const QString &name)
+{
+    // Requests name files for the server to read, so only its own user
+    // may connect.
+    p->server.setSocketOptions(QLocalServer::UserAccessOption);
+    if (p->server.listen(name))
+        return true;
+    if (p->server.serverError() != QAbstractSocket::AddressInUseError)
+        return false;
+
+    // A server that still answers keeps its name, only a stale socket
+    // left by a crash is removed.
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(1000))
+    {
+        probe.disconnectFromServer();
+        return false;
+    }
+
+    QLocalServer::removeServer(name);
+    return p->server.listen(name);
+}
+
+void ClassifyServer::close()
+{
+    p->server.close();
+}
+
+QString ClassifyServer::fullServerName() const
+{
+    return p->server.fullServerName();
+}
+
+QString ClassifyServer::errorString() const
+{
+    return p->server.errorString();
+}
+
+QString ClassifyServer::modelPath() const
+{
+    return p->modelPath;
+}
+
+void ClassifyServer::setModelPath(const QString &path)
+{
+    if (p->modelPath == path)
+        return;
+
+    if (p->watcher.files().count())
+        p->watcher.removePaths(p->watcher.files());
+
+    p->modelPath = path;
+    if (!path.isEmpty())
+        p->watcher.addPath(path);
+}
+
+qint32 ClassifyServer::threads() const
+{
+    return p->pool.maxThreadCount();
+}
+
+void ClassifyServer::setThreads(qint32 threads)
+{
+    p->pool.setMaxThreadCount(threads > 0? threads : QThread::idealThreadCount());
+}
+
+qint64 ClassifyServer::requests() const
+{
+    return p->requests;
+}
+
+bool ClassifyServer::reload()
+{
+    if (p->modelPath.isEmpty())
+        return false;
+
+    // A rename replaces the watched file, so it's watched again.
+    if (!p->watcher.files().contains(p->modelPath) && QFileInfo::exists(p->modelPath))
+        p->watcher.addPath(p->modelPath);
+
+    // A failed load leaves the previous model in place.
+    const bool succeeded = p->fetcher->loadModel(p->modelPath);
+    Q_EMIT reloaded(succeeded);
+    return succeeded;
+}
+
+void ClassifyServer::newConnection()
+{
+    while (p->server.hasPendingConnections())
+    {
+        QLocalSocket *socket = p->server.nextPendingConnection();
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket](){ readRequests(socket); });
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+    }
+}
+
+void ClassifyServer::readRequests(QLocalSocket *socket)
+{
+    while (socket->bytesAvailable() >= 4)
+    {
+        const QByteArray head = socket->peek(4);
+        const quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(head.constData()));
+        if (length > MAXIMUM_FRAME)
+        {
+            socket->write(frame({ {"error", "message too large"} }));
+            socket->disconnectFromServer();
+            return;
+        }
+        if (socket->bytesAvailable() < 4 + static_cast<qint64>(length))
+            return;
+
+        socket->read(4);
+        handleRequest(socket, socket->read(length));
+    }
+}
+
+void ClassifyServer::handleRequest(QLocalSocket *socket, const QByteArray &payload)
+{
+    QJsonParseError error;
+    const QVariantMap request = QJsonDocument::fromJson(payload, &error).toVariant().toMap();
+    if (error.error != QJsonParseError::NoError)
+    {
+        socket->write(frame({ {"error", error.errorString()} }));
+        return;
+    }
+
+    const QVariant id = request.value("id");
+    const QString command = request.value("command").toString();
+    if (command == "reload")
+    {
+        socket->write(frame({ {"id", id}, {"result", reload()} }));
+        return;
+    }
+    if (!command.isEmpty())
+    {
+        socket->write(frame({ {"id", id}, {"error", "unknown command " + command} }));
+        return;
+    }
+    if (!request.contains("path") && !request.contains("months"))
+    {
+        socket->write(frame({ {"id", id}, {"error", "a request needs a path or months"} }));
+        return;
+    }
+
+    // The classifier is captured here, so a reload never changes the
+    // model under a running request.
+    const DataFetcher::Classifier classifier = p->classifier;
+    QPointer<QLocalSocket> target(socket);
+    QFutureWatcher<QVariantMap> *watcher = new QFutureWatcher<QVariantMap>(this);
+    connect(watcher, &QFutureWatcher<QVariantMap>::finished, this, [this, watcher, target, id](){
+        watcher->deleteLater();
+        p->requests++;
+        if (!target)
+            return;
+
+        const QVariantMap result = watcher->result();
+        if (result.isEmpty())
+            target->write(frame({ {"id", id}, {"error", "nothing to classify"} }));
+        else if (result.contains("error"))
+            target->write(frame({ {"id", id}, {"error", result.value("error")} }));
+        else
+            target->write(frame({ {"id", id}, {"result", result} }));
+    });
+    watcher->setFuture(QtConcurrent::run(&p->pool, [classifier, request](){ return classifier(request); }));
+}
+
+QByteArray ClassifyServer::frame(const QVariantMap &message)
+{
+    const QByteArray payload = QJsonDocument::fromVariant(message).toJson(QJsonDocument::Compact);
+    QByteArray res(4, 0);
+    qToBigEndian<quint32>(payload.size(), reinterpret_cast<uchar*>(res.data()));
+    return res + payload;
+}
+
+ClassifyServer::~ClassifyServer()
+{
+    p->server.close();
+    p->pool.waitForDone();
+    delete p;
+}
@@ -0,0 +1,85 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLASSIFYSERVER_H
+#define CLASSIFYSERVER_H
+
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+
+class DataFetcher;
+class QLocalSocket;
+
+/*!
+ * Keeps the fetcher's model resident and answers classification requests
+ * on a local socket. Every message, both ways, is a 32-bit big-endian byte
+ * length followed by a JSON object of that size:
+ *
+ *   {"id": 1, "path": "/chats/Friend.json"}
+ *   {"id": 2, "months": {"2019-01": {"messages": 120, ...}, ...}}
+ *   {"id": 3, "command": "reload"}
+ *
+ * Replies echo the id with either the "result" of DataFetcher::check()
+ * or an "error". Requests are scored on a worker pool, so a client that
+ * sends several at once gets the replies in completion order.
+ *
+ * A model path given to setModelPath() is watched, a new snapshot saved
+ * over it replaces the model without dropping a connection. Requests
+ * already running finish against the model they started with.
+ */
+class ClassifyServer : public QObject
+{
+    Q_OBJECT
+    class Private;
+
+public:
+    ClassifyServer(DataFetcher *fetcher, QObject *parent = Q_NULLPTR);
+    virtual ~ClassifyServer();
+
+    bool listen(const QString &name); // Only the owning user may connect, a stale socket of the name is replaced
+    void close();
+    QString fullServerName() const;
+    QString errorString() const;
+
+    QString modelPath() const;
+    void setModelPath(const QString &path);
+
+    qint32 threads() const;
+    void setThreads(qint32 threads);
+
+    qint64 requests() const; // Answered since the server was created
+
+    static QByteArray frame(const QVariantMap &message); // Length prefixed, for clients
+
+public Q_SLOTS:
+    bool reload();
+
+Q_SIGNALS:
+    void reloaded(bool succeeded);
+
+private:
+    void newConnection();
+    void readRequests(QLocalSocket *socket);
+    void handleRequest(QLocalSocket *socket, const QByteArray &payload);
+
+private:
+    Private *p;
+};
+
+#endif // CLASSIFYSERVER_H
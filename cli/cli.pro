@@ -0,0 +1,13 @@
+TARGET = tganalizer
+QT = core network
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+include(../core/core.pri)
+
+SOURCES += \
+    classifyserver.cpp \
+    main.cpp
+
+HEADERS += \
+    classifyserver.h
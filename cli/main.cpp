@@ -0,0 +1,355 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocalSocket>
+#include <QtEndian>
+
+#include "datafetcher.h"
+#include "classifyserver.h"
+
+static QFile output;
+
+static void print(const QVariantMap &map)
+{
+    output.write(QJsonDocument::fromVariant(map).toJson(QJsonDocument::Compact) + '\n');
+    output.flush();
+}
+
+static int fail(const QString &message)
+{
+    QFile err;
+    err.open(stderr, QFile::WriteOnly);
+    err.write("tganalizer: " + message.toUtf8() + '\n');
+    return 1;
+}
+
+static QStringList labelNames(DataFetcher *fetcher)
+{
+    QStringList res;
+    for (const QVariant &v: fetcher->labels())
+        res << v.toMap().value("label").toString();
+    return res;
+}
+
+static bool prepare(DataFetcher *fetcher, const QCommandLineParser &parser)
+{
+    if (parser.isSet("source"))
+    {
+        fetcher->setSource(parser.value("source"));
+        return true;
+    }
+    if (parser.isSet("model"))
+        return fetcher->loadModel(parser.value("model"));
+
+    return false;
+}
+
+static int train(DataFetcher *fetcher, const QCommandLineParser &parser, const QStringList &args)
+{
+    if (args.count() != 1 || !parser.isSet("model"))
+        return fail("train needs a source directory and --model");
+    if (parser.isSet("partial") && parser.isSet("single-pass"))
+        return fail("--partial keeps the values for merge, it can't be used with --single-pass");
+    if (!QFileInfo(args.first()).isDir())
+        return fail(args.first() + " is not a directory");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    fetcher->setSource(args.first());
+    if (fetcher->labels().isEmpty())
+        return fail("no training data in " + args.first());
+    if (!fetcher->saveModel(parser.value("model"), parser.isSet("partial")))
+        return fail("can't write " + parser.value("model"));
+
+    print({ {"command", "train"}, {"model", parser.value("model")}, {"partial", parser.isSet("partial")},
+            {"labels", labelNames(fetcher)}, {"elapsed", timer.elapsed()}, {"stats", fetcher->stats()} });
+    return 0;
+}
+
+static int merge(DataFetcher *fetcher, const QCommandLineParser &parser, const QStringList &args)
+{
+    if (args.isEmpty() || !parser.isSet("model"))
+        return fail("merge needs at least one snapshot and --model");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!fetcher->mergeModels(args))
+        return fail("can't merge the snapshots");
+    if (!fetcher->saveModel(parser.value("model")))
+        return fail("can't write " + parser.value("model"));
+
+    print({ {"command", "merge"}, {"model", parser.value("model")}, {"shards", args.count()},
+            {"labels", labelNames(fetcher)}, {"elapsed", timer.elapsed()} });
+    return 0;
+}
+
+static int classify(DataFetcher *fetcher, const QCommandLineParser &parser, const QStringList &args)
+{
+    if (args.isEmpty())
+        return fail("classify needs at least one file or directory");
+    if (!prepare(fetcher, parser))
+        return fail("classify needs a loadable --model or a --source directory");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (parser.isSet("output"))
+    {
+        const qint32 count = fetcher->classify(args, DataFetcher::RecordCallback(), parser.value("output"));
+        if (count < 0)
+            return fail("can't write " + parser.value("output"));
+
+        print({ {"command", "classify"}, {"output", parser.value("output")},
+                {"count", count}, {"elapsed", timer.elapsed()} });
+        return 0;
+    }
+
+    fetcher->classify(args, [](const QVariantMap &record){ print(record); });
+    return 0;
+}
+
+static int eval(DataFetcher *fetcher, const QCommandLineParser &parser, const QStringList &args)
+{
+    if (args.isEmpty())
+        return fail("eval needs at least one labeled file or directory");
+    if (!prepare(fetcher, parser))
+        return fail("eval needs a loadable --model or a --source directory");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Records come one at a time, so the counters need no locking.
+    qint32 files = 0;
+    qint32 skipped = 0;
+    qint32 correct = 0;
+    QMap<QString, QPair<qint32, qint32> > labels;
+    fetcher->classify(args, [&](const QVariantMap &record){
+        files++;
+
+        const QString label = record.value("label").toString();
+        if (label.isEmpty() || record.contains("error"))
+        {
+            skipped++;
+            return;
+        }
+
+        QPair<qint32, qint32> &l = labels[label];
+        l.first++;
+        if (record.value("resultLabel").toString() == label)
+        {
+            l.second++;
+            correct++;
+        }
+    });
+
+    const qint32 evaluated = files - skipped;
+
+    QVariantMap labelsMap;
+    QMapIterator<QString, QPair<qint32, qint32> > i(labels);
+    while (i.hasNext())
+    {
+        i.next();
+        labelsMap[i.key()] = QVariantMap({ {"files", i.value().first}, {"correct", i.value().second},
+                                           {"accuracy", static_cast<qreal>(i.value().second) / i.value().first} });
+    }
+
+    print({ {"command", "eval"}, {"files", files}, {"skipped", skipped}, {"correct", correct},
+            {"accuracy", evaluated? static_cast<qreal>(correct) / evaluated : 0},
+            {"labels", labelsMap}, {"elapsed", timer.elapsed()} });
+    return 0;
+}
+
+static int crossval(DataFetcher *fetcher, const QCommandLineParser &parser, const QStringList &args)
+{
+    if (args.count() != 1)
+        return fail("crossval needs a source directory");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVariantMap res = fetcher->evaluate(parser.value("folds").toInt(), args.first());
+    res["command"] = "crossval";
+    res["elapsed"] = timer.elapsed();
+    print(res);
+    return 0;
+}
+
+static int serve(DataFetcher *fetcher, const QCommandLineParser &parser)
+{
+    if (!prepare(fetcher, parser))
+        return fail("serve needs a loadable --model or a --source directory");
+
+    ClassifyServer server(fetcher);
+    if (!parser.isSet("source"))
+        server.setModelPath(parser.value("model"));
+    if (!server.listen(parser.value("socket")))
+        return fail("can't listen on " + parser.value("socket") + ": " + server.errorString());
+
+    QObject::connect(&server, &ClassifyServer::reloaded, [](bool succeeded){
+        print({ {"command", "reload"}, {"succeeded", succeeded} });
+    });
+
+    print({ {"command", "serve"}, {"socket", server.fullServerName()}, {"labels", labelNames(fetcher)} });
+    return QCoreApplication::exec();
+}
+
+static bool readReply(QLocalSocket *socket, QVariantMap *reply)
+{
+    while (socket->bytesAvailable() < 4)
+        if (!socket->waitForReadyRead(30000))
+            return false;
+
+    const QByteArray head = socket->read(4);
+    const qint64 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(head.constData()));
+    QByteArray payload;
+    while (payload.size() < length)
+    {
+        if (!socket->bytesAvailable() && !socket->waitForReadyRead(30000))
+            return false;
+        payload += socket->read(length - payload.size());
+    }
+
+    *reply = QJsonDocument::fromJson(payload).toVariant().toMap();
+    return true;
+}
+
+static int query(const QCommandLineParser &parser, const QStringList &args)
+{
+    if (args.isEmpty())
+        return fail("query needs at least one file");
+
+    QLocalSocket socket;
+    socket.connectToServer(parser.value("socket"));
+    if (!socket.waitForConnected(1000))
+        return fail("can't connect to " + parser.value("socket") + ": " + socket.errorString());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Everything is sent up front, replies come back in completion order.
+    for (qint32 i=0; i<args.count(); i++)
+        socket.write(ClassifyServer::frame({ {"id", i}, {"path", QFileInfo(args.at(i)).absoluteFilePath()} }));
+
+    for (qint32 i=0; i<args.count(); i++)
+    {
+        QVariantMap reply;
+        if (!readReply(&socket, &reply))
+            return fail("no reply from " + parser.value("socket"));
+
+        reply["path"] = args.value(reply.value("id").toInt());
+        print(reply);
+    }
+
+    print({ {"command", "query"}, {"count", args.count()}, {"elapsed", timer.elapsed()} });
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    qsrand(1601353213);
+
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("tganalizer");
+    app.setOrganizationName("Aseman");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless TgAnalizer. Every command prints one JSON object per line.\n\n"
+                                     "  train <directory>       train on the *.json exports and save --model\n"
+                                     "  merge <snapshots...>    merge models trained on shards with --partial\n"
+                                     "  classify <paths...>     classify files or directories, one record each\n"
+                                     "  eval <paths...>         classify labeled files and report the accuracy\n"
+                                     "  crossval <directory>    cross-validate on the files of a directory\n"
+                                     "  serve                   keep the model resident and answer on --socket\n"
+                                     "  query <paths...>        classify files through a running server\n\n"
+                                     "Files are either chat summaries or raw Telegram Desktop exports. An export is\n"
+                                     "labeled by its file name up to the first dot, e.g. \"Close rel.json\" and\n"
+                                     "\"Close rel.2.json\", or by its directory while still named result.json, e.g.\n"
+                                     "\"Close rel/result.json\" below the source directory.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "train, merge, classify, eval, crossval, serve or query");
+    parser.addOptions({
+        {{"m", "model"}, "Model snapshot, written by train and read by classify and eval.", "file"},
+        {{"s", "source"}, "Train on this directory instead of loading --model.", "directory"},
+        {{"o", "output"}, "Write classify records to a .csv or .jsonl file.", "file"},
+        {{"t", "threads"}, "Worker threads, all cores by default.", "count"},
+        {{"p", "properties"}, "Comma separated properties to score on.", "list"},
+        {"trace", "Write a Chrome trace of the training phases to this file.", "file"},
+        {{"k", "folds"}, "Folds of crossval, leave-one-out by default.", "count"},
+        {"socket", "Local socket of serve and query. Defaults to tganalizer.", "name", "tganalizer"},
+        {{"r", "resolution"}, "Buckets per property, 0 picks them per property. Defaults to 1000.", "count"},
+        {"compact", "Keep the training values as float32."},
+        {"partial", "Let train write a shard for merge, without its bins."},
+        {"single-pass", "Bin the values while reading and never keep them, for corpora larger than memory."},
+        {"scorer", "Score values with smooth or linear buckets. Defaults to smooth.", "name", "smooth"},
+        {"memory-budget", "Pack the training values once they would outgrow this many MB.", "MB"},
+    });
+    parser.process(app);
+
+    output.open(stdout, QFile::WriteOnly);
+
+    QStringList args = parser.positionalArguments();
+    if (args.isEmpty())
+        parser.showHelp(1);
+
+    const QString command = args.takeFirst();
+
+    DataFetcher fetcher;
+    if (parser.isSet("threads"))
+        fetcher.setThreads(parser.value("threads").toInt());
+    if (parser.isSet("resolution"))
+        fetcher.setResolution(parser.value("resolution").toInt());
+    if (parser.isSet("compact"))
+        fetcher.setCompact(true);
+    if (parser.value("scorer") == "linear")
+        fetcher.setScorer(DataFetcher::LinearScorer);
+    else if (parser.value("scorer") != "smooth")
+        return fail("unknown scorer " + parser.value("scorer"));
+    if (parser.isSet("single-pass"))
+        fetcher.setSinglePass(true);
+    if (parser.isSet("memory-budget"))
+        fetcher.setMemoryBudget(parser.value("memory-budget").toInt());
+    if (parser.isSet("trace"))
+        fetcher.setTrace(parser.value("trace"));
+    if (parser.isSet("properties"))
+        fetcher.setProperties(parser.value("properties").split(',', QString::SkipEmptyParts));
+
+    if (command == "train")
+        return train(&fetcher, parser, args);
+    if (command == "merge")
+        return merge(&fetcher, parser, args);
+    if (command == "classify")
+        return classify(&fetcher, parser, args);
+    if (command == "eval")
+        return eval(&fetcher, parser, args);
+    if (command == "crossval")
+        return crossval(&fetcher, parser, args);
+    if (command == "serve")
+        return serve(&fetcher, parser);
+    if (command == "query")
+        return query(parser, args);
+
+    return fail("unknown command " + command);
+}
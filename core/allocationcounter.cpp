@@ -0,0 +1,78 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "allocationcounter.h"
+
+#include <QAtomicInteger>
+
+#include <cstdlib>
+
+#if defined(TGANALIZER_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+
+// Qt containers call malloc directly and operator new ends up there too,
+// so the C allocator itself is interposed. glibc keeps the real one
+// reachable under its __libc_ names.
+static QAtomicInteger<qint64> allocations;
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) noexcept
+{
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept
+{
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_realloc(ptr, size);
+}
+}
+
+bool AllocationCounter::isEnabled()
+{
+    return true;
+}
+
+qint64 AllocationCounter::count()
+{
+    return allocations.load();
+}
+
+#else
+
+bool AllocationCounter::isEnabled()
+{
+    return false;
+}
+
+qint64 AllocationCounter::count()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+/*!
+ * Counts the heap allocations (malloc, calloc and realloc calls) of the
+ * whole process. Only debug builds on glibc count them, everywhere else
+ * the counter is disabled and costs nothing.
+ */
+class AllocationCounter
+{
+public:
+    static bool isEnabled();
+    static qint64 count();
+};
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,75 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "arena.h"
+
+#include <cstdlib>
+
+Arena::Arena(qint64 blockSize) :
+    blockSize(blockSize)
+{
+}
+
+void *Arena::allocate(qint64 size, qint64 alignment)
+{
+    if (size <= 0)
+        return Q_NULLPTR;
+
+    quintptr start = (reinterpret_cast<quintptr>(cursor) + alignment - 1) & ~static_cast<quintptr>(alignment - 1);
+    if (!cursor || start + static_cast<quintptr>(size) > reinterpret_cast<quintptr>(end))
+    {
+        const qint64 blockBytes = qMax(blockSize, size + alignment);
+        char *block = static_cast<char*>(malloc(static_cast<size_t>(blockBytes)));
+        Q_CHECK_PTR(block);
+        list << block;
+        reserved += blockBytes;
+
+        start = (reinterpret_cast<quintptr>(block) + alignment - 1) & ~static_cast<quintptr>(alignment - 1);
+
+        // Oversized requests get a block of their own, the current block
+        // stays open for the small ones.
+        if (blockBytes > blockSize && cursor)
+        {
+            usedBytes += size;
+            return reinterpret_cast<void*>(start);
+        }
+
+        end = block + blockBytes;
+    }
+
+    cursor = reinterpret_cast<char*>(start + static_cast<quintptr>(size));
+    usedBytes += size;
+    return reinterpret_cast<void*>(start);
+}
+
+void Arena::clear()
+{
+    for (char *block: list)
+        free(block);
+
+    list.clear();
+    cursor = Q_NULLPTR;
+    end = Q_NULLPTR;
+    reserved = 0;
+    usedBytes = 0;
+}
+
+Arena::~Arena()
+{
+    clear();
+}
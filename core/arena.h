@@ -0,0 +1,58 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <QtGlobal>
+#include <QVector>
+
+/*!
+ * Bump allocator. Memory is handed out of large blocks and only ever
+ * released all at once, by clear() or the destructor, so it suits data
+ * that is built in one go and dropped together. Objects placed in it are
+ * never destroyed, they have to be trivially destructible.
+ */
+class Arena
+{
+public:
+    Arena(qint64 blockSize = 1024 * 1024);
+    virtual ~Arena();
+
+    void *allocate(qint64 size, qint64 alignment = 16);
+    template<typename T>
+    T *allocate(qint64 count) { return static_cast<T*>(allocate(count * static_cast<qint64>(sizeof(T)), Q_ALIGNOF(T))); }
+
+    void clear();
+
+    qint64 bytes() const { return reserved; } // Held in blocks
+    qint64 used() const { return usedBytes; }
+    qint32 blocks() const { return list.count(); }
+
+private:
+    Q_DISABLE_COPY(Arena)
+
+    QVector<char*> list;
+    qint64 blockSize;
+    char *cursor = Q_NULLPTR; // Next free byte of the current block
+    char *end = Q_NULLPTR;
+    qint64 reserved = 0;
+    qint64 usedBytes = 0;
+};
+
+#endif // ARENA_H
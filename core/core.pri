@@ -0,0 +1,12 @@
+QT += concurrent
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+# Shadowed, so projects at any depth find the library in the build tree.
+win32:CONFIG(release, debug|release): CORE_DIR = $$shadowed($$PWD)/release
+else:win32:CONFIG(debug, debug|release): CORE_DIR = $$shadowed($$PWD)/debug
+else: CORE_DIR = $$shadowed($$PWD)
+
+LIBS += -L$$CORE_DIR -ltganalizercore
+win32-msvc*: PRE_TARGETDEPS += $$CORE_DIR/tganalizercore.lib
+else: PRE_TARGETDEPS += $$CORE_DIR/libtganalizercore.a
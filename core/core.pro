@@ -0,0 +1,40 @@
+TEMPLATE = lib
+TARGET = tganalizercore
+CONFIG += staticlib c++11
+QT = core concurrent
+
+# Debug builds count heap allocations, see allocationcounter.h
+CONFIG(debug, debug|release): DEFINES += TGANALIZER_COUNT_ALLOCATIONS
+
+SOURCES += \
+    allocationcounter.cpp \
+    arena.cpp \
+    datafetcher.cpp \
+    hashingdevice.cpp \
+    histogramtable.cpp \
+    jsonscanner.cpp \
+    jsonstreamreader.cpp \
+    propertymodel.cpp \
+    resultcache.cpp \
+    scoringkernel.cpp \
+    streaminghistogram.cpp \
+    stringpool.cpp \
+    telegramexportreader.cpp \
+    tracer.cpp
+
+HEADERS += \
+    allocationcounter.h \
+    arena.h \
+    datafetcher.h \
+    datafetcher_p.h \
+    hashingdevice.h \
+    histogramtable.h \
+    jsonscanner.h \
+    jsonstreamreader.h \
+    propertymodel.h \
+    resultcache.h \
+    scoringkernel.h \
+    streaminghistogram.h \
+    stringpool.h \
+    telegramexportreader.h \
+    tracer.h
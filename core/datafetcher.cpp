@@ -0,0 +1,2650 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define SNAPSHOT_MAGIC "TGAMODEL"
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+#define SNAPSHOT_UNBINNED 0x1
+#define SNAPSHOT_SCORED 0x2
+
+#include "datafetcher.h"
+#include "datafetcher_p.h"
+#include "hashingdevice.h"
+#include "allocationcounter.h"
+#include "jsonstreamreader.h"
+#include "telegramexportreader.h"
+#include "scoringkernel.h"
+#include "propertymodel.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QList>
+#include <QHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QJsonDocument>
+#include <QDebug>
+#include <QtMath>
+
+#include <cstring>
+#include <algorithm>
+
+/*
+ * Model snapshot layout. Every section is an array of fixed size records
+ * stored back to back in this order, and every record size is a multiple
+ * of 8, so a mapped file can be read in place:
+ *
+ *   SnapshotHeader
+ *   SnapshotLabel[labelsCount]
+ *   SnapshotProperty[propertiesCount]
+ *   SnapshotEntry[entriesCount]        one per (property, label)
+ *   SnapshotBin[binsCount]             occupied function buckets
+ *   double[scoresCount]                smoothed scores, resolution+1 rows
+ *                                      of labelsCount per scored property
+ *   double[valuesCount]                training values
+ *   char[stringsSize]                  UTF-8 names
+ *
+ * Partial snapshots leave the bins and scores out and flag their
+ * properties as unbinned. Values and ranges are all a merge needs, and
+ * binning waits for the ranges of every shard. Scoring never reads the
+ * values, so a loaded model leaves them in the mapping.
+ */
+class DataFetcher::Private::SnapshotHeader
+{
+public:
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    quint32 labelsCount;
+    quint32 propertiesCount;
+    quint32 entriesCount;
+    qint32 resolution;
+    quint64 binsCount;
+    quint64 scoresCount;
+    quint64 valuesCount;
+    quint64 stringsSize;
+};
+
+class DataFetcher::Private::SnapshotLabel
+{
+public:
+    quint32 nameOffset;
+    quint32 nameSize;
+    quint32 color;
+    qint32 index;
+};
+
+class DataFetcher::Private::SnapshotProperty
+{
+public:
+    quint32 nameOffset;
+    quint32 nameSize;
+    quint32 firstEntry;
+    quint32 entriesCount;
+    quint32 resolution;
+    quint32 flags;
+    double minimum;
+    double maximum;
+    double sum;
+    quint64 firstScore;
+};
+
+class DataFetcher::Private::SnapshotEntry
+{
+public:
+    quint32 label;
+    quint32 binsCount;
+    quint32 valuesCount;
+    quint32 samples; // Of a single pass model, which has no values
+    quint64 firstBin;
+    quint64 firstValue;
+};
+
+class DataFetcher::Private::SnapshotBin
+{
+public:
+    qint32 index;
+    quint32 reserved;
+    double value;
+};
+
+DataFetcher::DataFetcher(QObject *parent) :
+    QObject(parent)
+{
+    p = new Private;
+    p->pool.setMaxThreadCount(QThread::idealThreadCount());
+    p->model = QSharedPointer<Private::Model>(new Private::Model);
+
+    p->refreshTimer = new QTimer(this);
+    p->refreshTimer->setSingleShot(true);
+    p->refreshTimer->setInterval(1000);
+    connect(p->refreshTimer, &QTimer::timeout, this, &DataFetcher::refresh);
+
+    p->propertyModel = new PropertyModel(this);
+}
+
+QString DataFetcher::source() const
+{
+    return p->source;
+}
+
+void DataFetcher::setSource(const QString &source)
+{
+    if (p->source == source)
+        return;
+
+    p->source = source;
+    if (p->watcher)
+    {
+        if (p->watcher->directories().count())
+            p->watcher->removePaths(p->watcher->directories());
+        p->watcher->addPath(source);
+    }
+
+    startTraining();
+}
+
+bool DataFetcher::incremental() const
+{
+    return p->incremental;
+}
+
+void DataFetcher::setIncremental(bool incremental)
+{
+    if (p->incremental == incremental)
+        return;
+
+    p->incremental = incremental;
+    Q_EMIT incrementalChanged();
+}
+
+bool DataFetcher::watch() const
+{
+    return p->watch;
+}
+
+void DataFetcher::setWatch(bool watch)
+{
+    if (p->watch == watch)
+        return;
+
+    p->watch = watch;
+    if (p->watch)
+    {
+        p->watcher = new QFileSystemWatcher(this);
+        if (!p->source.isEmpty())
+            p->watcher->addPath(p->source);
+
+        // Exports are usually written in bursts, so wait for the directory
+        // to settle before re-reading it.
+        connect(p->watcher, &QFileSystemWatcher::directoryChanged, p->refreshTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    }
+    else
+    {
+        delete p->watcher;
+        p->watcher = Q_NULLPTR;
+        p->refreshTimer->stop();
+    }
+
+    Q_EMIT watchChanged();
+}
+
+void DataFetcher::refresh()
+{
+    if (p->source.isEmpty())
+        return;
+
+    startTraining();
+}
+
+bool DataFetcher::asynchronous() const
+{
+    return p->asynchronous;
+}
+
+void DataFetcher::setAsynchronous(bool asynchronous)
+{
+    if (p->asynchronous == asynchronous)
+        return;
+
+    p->asynchronous = asynchronous;
+    Q_EMIT asynchronousChanged();
+}
+
+qint32 DataFetcher::resolution() const
+{
+    return p->resolution;
+}
+
+void DataFetcher::setResolution(qint32 resolution)
+{
+    if (resolution > 0)
+        resolution = qBound(MINIMUM_RESOLUTION, resolution, MAXIMUM_RESOLUTION);
+    if (p->resolution == resolution)
+        return;
+
+    p->resolution = qMax(resolution, 0);
+    Q_EMIT resolutionChanged();
+}
+
+bool DataFetcher::compact() const
+{
+    return p->compact;
+}
+
+void DataFetcher::setCompact(bool compact)
+{
+    if (p->compact == compact)
+        return;
+
+    p->compact = compact;
+    Q_EMIT compactChanged();
+}
+
+qint32 DataFetcher::memoryBudget() const
+{
+    return p->memoryBudget;
+}
+
+void DataFetcher::setMemoryBudget(qint32 memoryBudget)
+{
+    memoryBudget = qMax(memoryBudget, 0);
+    if (p->memoryBudget == memoryBudget)
+        return;
+
+    p->memoryBudget = memoryBudget;
+    Q_EMIT memoryBudgetChanged();
+}
+
+bool DataFetcher::singlePass() const
+{
+    return p->singlePass;
+}
+
+void DataFetcher::setSinglePass(bool singlePass)
+{
+    if (p->singlePass == singlePass)
+        return;
+
+    p->singlePass = singlePass;
+    Q_EMIT singlePassChanged();
+}
+
+DataFetcher::Scorer DataFetcher::scorer() const
+{
+    return p->scorer;
+}
+
+void DataFetcher::setScorer(Scorer scorer)
+{
+    if (p->scorer == scorer)
+        return;
+
+    p->scorer = scorer;
+    Q_EMIT scorerChanged();
+}
+
+qint32 DataFetcher::cacheSize() const
+{
+    return p->cache.capacity();
+}
+
+void DataFetcher::setCacheSize(qint32 cacheSize)
+{
+    cacheSize = qMax(cacheSize, 0);
+    if (p->cache.capacity() == cacheSize)
+        return;
+
+    p->cache.setCapacity(cacheSize);
+    Q_EMIT cacheSizeChanged();
+}
+
+QString DataFetcher::cacheDirectory() const
+{
+    return p->cache.directory();
+}
+
+void DataFetcher::setCacheDirectory(const QString &cacheDirectory)
+{
+    if (p->cache.directory() == cacheDirectory)
+        return;
+
+    p->cache.setDirectory(cacheDirectory);
+    Q_EMIT cacheDirectoryChanged();
+}
+
+bool DataFetcher::streaming() const
+{
+    return p->streaming;
+}
+
+void DataFetcher::setStreaming(bool streaming)
+{
+    if (p->streaming == streaming)
+        return;
+
+    p->streaming = streaming;
+    Q_EMIT streamingChanged();
+}
+
+bool DataFetcher::training() const
+{
+    return !p->job.isNull();
+}
+
+QString DataFetcher::trace() const
+{
+    return p->trace;
+}
+
+void DataFetcher::setTrace(const QString &trace)
+{
+    if (p->trace == trace)
+        return;
+
+    p->trace = trace;
+    Q_EMIT traceChanged();
+}
+
+QVariantMap DataFetcher::stats() const
+{
+    QSharedPointer<Private::Model> model = p->model;
+
+    // Counted on demand, so training doesn't pay for them.
+    qint64 buckets = 0;
+    QVariantMap values;
+    for (const Private::PropertyItem &pItem: model->properties)
+    {
+        if (!pItem.count)
+            continue;
+
+        values[pItem.property] = pItem.count;
+        for (qint32 r=0; r<pItem.functions.rows(); r++)
+        {
+            const qreal *function = pItem.functions.row(r);
+            for (qint32 i=0; i<pItem.functions.columns(); i++)
+                if (function[i] != 0)
+                    buckets++;
+        }
+    }
+
+    QVariantMap res = model->stats;
+    res["labels"] = model->items.count();
+    res["properties"] = values.count();
+    res["bucketsFilled"] = buckets;
+    res["values"] = values;
+    return res;
+}
+
+QStringList DataFetcher::properties() const
+{
+    return p->propertiesValue;
+}
+
+void DataFetcher::setProperties(const QStringList &properties)
+{
+    if (p->propertiesValue == properties)
+        return;
+
+    p->propertiesValue = properties;
+    Q_EMIT propertiesChanged();
+}
+
+QVariantList DataFetcher::mergables() const
+{
+    return p->mergables;
+}
+
+void DataFetcher::setMergables(const QVariantList &mergables)
+{
+    if (p->mergables == mergables)
+        return;
+
+    p->mergables = mergables;
+    Q_EMIT mergablesChanged();
+}
+
+qint32 DataFetcher::threads() const
+{
+    return p->threads;
+}
+
+void DataFetcher::setThreads(qint32 threads)
+{
+    if (p->threads == threads)
+        return;
+
+    p->threads = threads;
+    p->pool.setMaxThreadCount(threads > 0? threads : QThread::idealThreadCount());
+    Q_EMIT threadsChanged();
+}
+
+QAbstractListModel *DataFetcher::propertyModel() const
+{
+    return p->propertyModel;
+}
+
+QVariantList DataFetcher::labels()
+{
+    QVariantList res;
+    for (const Private::DataItem &item: p->model->items)
+    {
+        QVariantMap map;
+        map["label"] = item.label;
+        map["color"] = Private::colorName(item.color);
+        map["labelIndex"] = item.index;
+
+        res << map;
+    }
+
+    return res;
+}
+
+bool DataFetcher::propertyValues(const QString &property, QVector<qint32> *labels, QVector<qreal> *values,
+                                 qreal *minimum, qreal *maximum) const
+{
+    QSharedPointer<Private::Model> model = p->model;
+    const qint32 id = model->propertyNames.id(property);
+    if (id < 0 || !model->properties.at(id).hasRange())
+        return false;
+
+    const Private::PropertyItem &pItem = model->properties.at(id);
+    *minimum = pItem.minimum;
+    *maximum = pItem.maximum;
+
+    labels->reserve(labels->count() + pItem.count);
+    values->reserve(values->count() + pItem.count);
+    for (const Private::PropertyLabel &pLabel: pItem.labels)
+    {
+        if (!pLabel.isValid())
+            continue;
+
+        for (qint32 i=0; i<pLabel.values.count(); i++)
+        {
+            *labels << pLabel.labelIndex;
+            *values << pLabel.values.at(i);
+        }
+    }
+
+    return true;
+}
+
+QVector<quint32> DataFetcher::labelColors() const
+{
+    QVector<quint32> res;
+    for (const Private::DataItem &item: p->model->items)
+        res << item.color;
+    return res;
+}
+
+QVariantMap DataFetcher::checkedMap() const
+{
+    return p->checkedMap;
+}
+
+QVariantMap DataFetcher::Private::classify(const ClassifyJob &job, const MonthMap &months, QVariantMap *checkedMap)
+{
+    if (months.isEmpty())
+        return {};
+
+    const Model *model = job.model.data();
+
+    // Rates are accumulated in dense per label id vectors, padded to the
+    // widest score row so the scoring kernel never needs a scalar tail.
+    const qint32 labelsCount = model->items.count();
+    const qint32 width = (labelsCount + 7) / 8 * 8;
+    QVector<qreal> globalRatesVector(width);
+    QVector<bool> globalSeen(labelsCount);
+
+    qreal globalRatesSum = 0;
+    bool scored = false;
+
+    QString res;
+    QVariantList monthsRates;
+    QMapIterator<QString, SumMap> mi(months);
+    while (mi.hasNext())
+    {
+        mi.next();
+
+        QVector<qreal> ratesVector(width);
+        QVector<bool> seen(labelsCount);
+
+        QMapIterator<QString, qreal> i(mi.value());
+        while (i.hasNext())
+        {
+            i.next();
+            QString property = i.key();
+            if (job.properties.count() && !job.properties.contains(property))
+                continue;
+
+            qreal value = i.value();
+
+            const qint32 propertyIndex = model->propertyNames.id(property);
+            if (propertyIndex < 0)
+                continue;
+
+            const PropertyItem &pItem = model->properties.at(propertyIndex);
+            if (!pItem.hasRange())
+                continue;
+
+            scored = true;
+            const qint32 index = pItem.index(value);
+            if (job.scorer == SmoothScorer && index >= 0 && index <= pItem.resolution && !pItem.scores.isEmpty())
+            {
+                const qreal *row = pItem.scores.row(index);
+                ScoringKernel::accumulate(ratesVector.data(), row, pItem.scores.stride());
+                ScoringKernel::accumulate(globalRatesVector.data(), row, pItem.scores.stride());
+            }
+            else
+            {
+                for (const PropertyLabel &pLabel: pItem.labels)
+                {
+                    if (!pLabel.isValid())
+                        continue;
+
+                    qreal rate = pLabel.checkRate(pItem, value, job.scorer);
+                    ratesVector[pLabel.labelIndex] += rate;
+                    globalRatesVector[pLabel.labelIndex] += rate;
+                }
+            }
+
+            for (const PropertyLabel &pLabel: pItem.labels)
+                if (pLabel.isValid())
+                    seen[pLabel.labelIndex] = globalSeen[pLabel.labelIndex] = true;
+
+            if (!checkedMap)
+                continue;
+
+            QVariantMap monthMap;
+            monthMap["month"] = mi.key();
+            monthMap["value"] = value;
+            monthMap["minimum"] = pItem.minimum;
+            monthMap["maximum"] = pItem.maximum;
+            monthMap["property"] = property;
+
+            QVariantList monthsList = checkedMap->value(property).toList();
+            monthsList << monthMap;
+
+            (*checkedMap)[property] = monthsList;
+        }
+
+        QHash<QString, qreal> rates;
+        for (qint32 l=0; l<labelsCount; l++)
+            if (seen.at(l))
+                rates[model->items.at(l).label] = ratesVector.at(l);
+
+        qreal ratesSum = 0;
+        QMap<qreal, QString> ratesMap;
+        QHashIterator<QString, qreal> ir(rates);
+        while (ir.hasNext())
+        {
+            ir.next();
+            QString property = ir.key();
+            qreal value = ir.value();
+
+            ratesSum += value;
+            globalRatesSum += value;
+            ratesMap[value] = property;
+        }
+
+        QVariantMap percentsMap;
+        QHashIterator<QString, qreal> pi(rates);
+        while (pi.hasNext())
+        {
+            pi.next();
+            percentsMap[pi.key()] = qFloor(pi.value()*1000/ratesSum)/10.0;
+        }
+
+        QVariantMap monthRates;
+        monthRates["month"] = mi.key();
+        monthRates["rates"] = percentsMap;
+        monthsRates << monthRates;
+
+        res += mi.key() + ": ";
+
+        QString valuesStr;
+        QMapIterator<qreal, QString> ri(ratesMap);
+        while (ri.hasNext())
+        {
+            ri.next();
+            if (!valuesStr.isEmpty())
+                valuesStr = ", " + valuesStr;
+
+            valuesStr = ri.value() + " (" + QString::number(qFloor(ri.key()*1000/ratesSum)/10.0) + "%)" + valuesStr;
+        }
+        res += valuesStr + "\n";
+    }
+
+    // Raw exports and summaries name their properties differently, so a
+    // model trained on one scores the other against nothing at all.
+    if (!scored)
+        return { {"error", "no known properties"} };
+
+    QHash<QString, qreal> globalRates;
+    for (qint32 l=0; l<labelsCount; l++)
+        if (globalSeen.at(l))
+            globalRates[model->items.at(l).label] = globalRatesVector.at(l);
+
+    for(const QVariant &v: job.mergables)
+    {
+        QVariantMap m = v.toMap();
+
+        QString title = m.value("title").toString();
+        QStringList list = m.value("list").toStringList();
+        for (const QString &l: list)
+            globalRates[title] += globalRates[l];
+    }
+
+    QMap<qreal, QString> globalRatesMap;
+    QHashIterator<QString, qreal> ir(globalRates);
+    while (ir.hasNext())
+    {
+        ir.next();
+        QString property = ir.key();
+        qreal value = ir.value();
+
+        globalRatesMap[value] = property;
+    }
+
+    if (globalRatesMap.isEmpty())
+        return {};
+
+    // A merged winner is shown as its title and best label, the label is
+    // kept apart so evaluations compare it with the files' own labels. A
+    // title none of whose labels scored has no label at all.
+    QString winner = globalRatesMap.last();
+    QString winnerLabel = winner;
+    for(const QVariant &v: job.mergables)
+    {
+        QVariantMap m = v.toMap();
+
+        QString title = m.value("title").toString();
+        if (winner != title)
+            continue;
+
+        qreal max = 0;
+        winnerLabel.clear();
+        QStringList list = m.value("list").toStringList();
+        for (const QString &l: list)
+            if (globalRates[l] > max)
+            {
+                winner = QString("%1 (%2)").arg(title).arg(l);
+                winnerLabel = l;
+                max = globalRates[l];
+            }
+    }
+
+    QString percents;
+    QMapIterator<qreal, QString> ri(globalRatesMap);
+    while (ri.hasNext())
+    {
+        ri.next();
+        if (ri.value() == "Friends")
+            continue;
+
+        if (!percents.isEmpty())
+            percents = ", " + percents;
+
+        percents = ri.value() + " (" + QString::number(qFloor(ri.key()*1000/globalRatesSum)/10.0) + "%)" + percents;
+    }
+
+    QVariantMap globalPercents;
+    QHashIterator<QString, qreal> gi(globalRates);
+    while (gi.hasNext())
+    {
+        gi.next();
+        globalPercents[gi.key()] = qFloor(gi.value()*1000/globalRatesSum)/10.0;
+    }
+
+    return { {"result", winner}, {"resultLabel", winnerLabel}, {"percents", percents}, {"string", res.trimmed()},
+             {"rates", globalPercents}, {"months", monthsRates} };
+}
+
+QVariantMap DataFetcher::check(const QString &path)
+{
+    QSharedPointer<Private::ClassifyJob> job = p->classifyJob();
+
+    // A miss reads the file once, hashing it on the way for the entry.
+    QVariantMap checkedMap;
+    QVariantMap res;
+    QVariantMap cached;
+    bool disk = false;
+    const QByteArray key = p->cache.isEnabled()? Private::cacheKey(*job, path) : QByteArray();
+    if (!key.isEmpty() && p->cache.find(job->model->version, key, &cached, &disk) &&
+        (!disk || cached.value("hash").toString() == QString::fromLatin1(Private::hashFile(path).toHex())))
+    {
+        res = cached.value("result").toMap();
+        checkedMap = cached.value("checkedMap").toMap();
+    }
+    else
+    {
+        Private::MonthMap months;
+        QByteArray hash;
+        if (!Private::readMonths(path, p->streaming, Q_NULLPTR, &months, Q_NULLPTR, Q_NULLPTR, key.isEmpty()? Q_NULLPTR : &hash))
+            res["error"] = "unreadable";
+        else
+            res = Private::classify(*job, months, &checkedMap);
+        if (!key.isEmpty())
+            p->cache.insert(job->model->version, key, { {"result", res}, {"checkedMap", checkedMap},
+                                                        {"hash", QString::fromLatin1(hash.toHex())} });
+    }
+
+    if (res.contains("error"))
+        qWarning() << "Can't classify" << path << "-" << res.value("error").toString();
+
+    p->checkedMap = checkedMap;
+    Q_EMIT checkedMapChanged();
+    return res;
+}
+
+qint32 DataFetcher::classify(const QStringList &paths, const RecordCallback &callback, const QString &output)
+{
+    QSharedPointer<Private::ClassifyJob> job = p->classifyJob();
+    return Private::classifyFiles(job.data(), paths, callback, output);
+}
+
+DataFetcher::Classifier DataFetcher::classifier() const
+{
+    QSharedPointer<Private::ClassifyJob> job = p->classifyJob();
+    return [job](const QVariantMap &request) -> QVariantMap {
+        Private::MonthMap months;
+        if (request.contains("months"))
+        {
+            QMapIterator<QString, QVariant> mi(request.value("months").toMap());
+            while (mi.hasNext())
+            {
+                mi.next();
+                Private::SumMap &sums = months[mi.key()];
+                QMapIterator<QString, QVariant> i(mi.value().toMap());
+                while (i.hasNext())
+                {
+                    i.next();
+                    sums[i.key()] = i.value().toDouble();
+                }
+            }
+        }
+        else if (!Private::readMonths(request.value("path").toString(), job->streaming, Q_NULLPTR, &months))
+            return {};
+
+        return Private::classify(*job, months, Q_NULLPTR);
+    };
+}
+
+QVariantMap DataFetcher::evaluate(qint32 folds, const QString &directory)
+{
+    Private::TrainJob job;
+    job.fetcher = this;
+    job.pool = &p->pool;
+    job.source = directory.isEmpty()? p->source : directory;
+    job.streaming = p->streaming;
+    job.incremental = false;
+    job.resolution = p->resolution;
+    job.memoryBudget = static_cast<qint64>(p->memoryBudget) * 1024 * 1024;
+    job.model = QSharedPointer<Private::Model>(new Private::Model);
+    job.model->resolution = p->resolution;
+    job.model->compact = p->compact;
+
+    return Private::evaluate(&job, folds, p->propertiesValue, p->mergables, p->scorer);
+}
+
+void DataFetcher::classifyBatch(const QVariant &paths, const QString &output)
+{
+    if (p->batch)
+    {
+        p->batch->canceled.storeRelease(1);
+        p->retire(p->batch->future);
+    }
+
+    QSharedPointer<Private::ClassifyJob> job = p->classifyJob();
+    p->batch = job;
+
+    QFutureWatcher<qint32> *watcher = new QFutureWatcher<qint32>(this);
+    connect(watcher, &QFutureWatcher<qint32>::finished, this, [this, watcher, job, output](){
+        watcher->deleteLater();
+        if (p->batch == job)
+            p->batch.clear();
+        if (job->isCanceled())
+            return;
+
+        Q_EMIT batchFinished(job->future.result(), output);
+    });
+
+    const QStringList list = paths.toStringList();
+    job->future = QtConcurrent::run([this, job, list, output](){
+        return Private::classifyFiles(job.data(), list, [this](const QVariantMap &record){
+            Q_EMIT classified(record);
+        }, output);
+    });
+    watcher->setFuture(job->future);
+}
+
+QByteArray DataFetcher::Private::cacheKey(const ClassifyJob &job, const QString &path)
+{
+    // Keyed without reading the file, the content hash stored with each
+    // entry only validates the ones that come back from disk.
+    QFileInfo info(path);
+    if (!info.isFile())
+        return QByteArray();
+
+    QCryptographicHash sha1(QCryptographicHash::Sha1);
+    sha1.addData(info.absoluteFilePath().toUtf8());
+    sha1.addData(QByteArray::number(info.size()) + ":" + QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+
+    // Compact columns score a hair differently, so they count as a version
+    // of their own.
+    sha1.addData(job.model->version);
+    sha1.addData(job.model->compact? "compact" : "full");
+    sha1.addData(QJsonDocument::fromVariant(QVariantMap({ {"properties", job.properties}, {"mergables", job.mergables},
+                                                          {"scorer", static_cast<qint32>(job.scorer)} }))
+                 .toJson(QJsonDocument::Compact));
+    return sha1.result();
+}
+
+QByteArray DataFetcher::Private::hashFile(const QString &path)
+{
+    QFile file(path);
+    QCryptographicHash sha1(QCryptographicHash::Sha1);
+    if (!file.open(QFile::ReadOnly) || !sha1.addData(&file))
+        return QByteArray();
+    return sha1.result();
+}
+
+void DataFetcher::Private::retire(const QFuture<void> &future)
+{
+    // A canceled job only stops at its next check and until then still
+    // uses the pool and emits through the fetcher, so the destructor waits
+    // for every one of them. Finished ones are dropped on the way.
+    for (qint32 i=retired.count()-1; i>=0; i--)
+        if (retired.at(i).isFinished())
+            retired.removeAt(i);
+
+    retired << future;
+}
+
+void DataFetcher::Private::setModel(const QSharedPointer<Model> &newModel)
+{
+    // A retrained model with other files or settings leaves its old version
+    // behind, so its disk entries can go. Snapshot versions come back with
+    // the same file.
+    cache.invalidate(model->version, !model->files.isEmpty() && model->version != newModel->version);
+    model = newModel;
+}
+
+QSharedPointer<DataFetcher::Private::ClassifyJob> DataFetcher::Private::classifyJob()
+{
+    QSharedPointer<ClassifyJob> job(new ClassifyJob);
+    job->pool = &pool;
+    job->streaming = streaming;
+    job->scorer = scorer;
+    job->properties = propertiesValue;
+    job->mergables = mergables;
+    job->model = model;
+    return job;
+}
+
+qint32 DataFetcher::Private::classifyFiles(ClassifyJob *job, const QStringList &paths, const RecordCallback &callback, const QString &output)
+{
+    const QStringList files = expandPaths(paths);
+
+    QSaveFile file(output);
+    const bool csv = output.endsWith(".csv", Qt::CaseInsensitive);
+    QStringList columns;
+    if (!output.isEmpty())
+    {
+        if (!file.open(QFile::WriteOnly))
+            return -1;
+
+        if (csv)
+        {
+            columns = job->model->labelNames.strings();
+            for(const QVariant &v: job->mergables)
+            {
+                const QString title = v.toMap().value("title").toString();
+                if (!columns.contains(title))
+                    columns << title;
+            }
+
+            QStringList header = {"path", "label", "result"};
+            for (const QString &c: columns)
+                header << csvField(c);
+            header << "error";
+            file.write(header.join(',').toUtf8() + '\n');
+        }
+    }
+
+    // Workers score files in any order, records are handed out one at a time.
+    QMutex mutex;
+    qint32 count = 0;
+    auto deliver = [&](const QVariantMap &record) {
+        QMutexLocker locker(&mutex);
+        count++;
+
+        if (file.isOpen())
+        {
+            if (csv)
+            {
+                const QVariantMap rates = record.value("rates").toMap();
+                QStringList line = { csvField(record.value("path").toString()), csvField(record.value("label").toString()),
+                                     csvField(record.value("result").toString()) };
+                for (const QString &c: columns)
+                    line << (rates.contains(c)? QString::number(rates.value(c).toDouble()) : QString());
+                line << csvField(record.value("error").toString());
+                file.write(line.join(',').toUtf8() + '\n');
+            }
+            else
+                file.write(QJsonDocument::fromVariant(record).toJson(QJsonDocument::Compact) + '\n');
+        }
+
+        if (callback)
+            callback(record);
+    };
+
+    auto classifyFile = [job](const QString &path) {
+        QVariantMap record;
+        QString label;
+        MonthMap months;
+        if (!readMonths(path, job->streaming, &label, &months))
+            record["error"] = "unreadable";
+        else
+        {
+            record = classify(*job, months, Q_NULLPTR);
+            if (record.isEmpty())
+                record["error"] = "no months";
+        }
+
+        record["path"] = path;
+        record["label"] = label;
+        return record;
+    };
+
+    QAtomicInt next(0);
+    const qint32 workers = qMax(1, qMin(job->pool->maxThreadCount(), files.count()));
+    QList< QFuture<void> > futures;
+    for (qint32 w=0; w<workers; w++)
+        futures << QtConcurrent::run(job->pool, [job, &files, &next, &deliver, &classifyFile](){
+            qint32 i;
+            while (!job->isCanceled() && (i = next.fetchAndAddRelaxed(1)) < files.count())
+                deliver(classifyFile(files.at(i)));
+        });
+
+    for (QFuture<void> &f: futures)
+        f.waitForFinished();
+
+    if (file.isOpen())
+    {
+        if (job->isCanceled())
+            file.cancelWriting();
+        if (!file.commit() && !job->isCanceled())
+            return -1;
+    }
+
+    return count;
+}
+
+QVariantMap DataFetcher::Private::evaluate(TrainJob *job, qint32 folds, const QStringList &properties, const QVariantList &mergables, Scorer scorer)
+{
+    // One model of every file, which keeps the values of each of them so
+    // a fold can take its files out again.
+    if (!update(job))
+        return {};
+
+    const Model *model = job->model.data();
+    QStringList paths;
+    for (QHash<QString, FileData>::ConstIterator it = model->files.constBegin(); it != model->files.constEnd(); it++)
+        if (it->valid)
+            paths << it.key();
+    std::sort(paths.begin(), paths.end());
+
+    if (folds <= 0 || folds > paths.count())
+        folds = paths.count();
+
+    QVector<QString> predictions(paths.count());
+    QAtomicInt next(0);
+    const qint32 workers = qMax(1, qMin(job->pool->maxThreadCount(), folds));
+    QList< QFuture<void> > futures;
+    for (qint32 w=0; w<workers; w++)
+        futures << QtConcurrent::run(job->pool, [job, model, folds, scorer, &paths, &properties, &mergables, &predictions, &next](){
+            qint32 fold;
+            while (!job->isCanceled() && (fold = next.fetchAndAddRelaxed(1)) < folds)
+            {
+                // Copies are shallow, only what the fold takes out is
+                // detached and binned again.
+                ClassifyJob classifyJob;
+                classifyJob.streaming = job->streaming;
+                classifyJob.scorer = scorer;
+                classifyJob.properties = properties;
+                classifyJob.mergables = mergables;
+                classifyJob.model = QSharedPointer<Model>(new Model(*model));
+
+                Changes changes;
+                for (qint32 i=fold; i<paths.count(); i+=folds)
+                    removeFile(classifyJob.model.data(), model->files.value(paths.at(i)), &changes);
+                rescanRanges(classifyJob.model.data(), changes);
+                rebin(classifyJob.model.data(), changes, job->resolution);
+
+                for (qint32 i=fold; i<paths.count(); i+=folds)
+                {
+                    MonthMap months;
+                    if (readMonths(paths.at(i), job->streaming, Q_NULLPTR, &months))
+                        predictions[i] = classify(classifyJob, months, Q_NULLPTR).value("resultLabel").toString();
+                }
+            }
+        });
+
+    for (QFuture<void> &f: futures)
+        f.waitForFinished();
+    if (job->isCanceled())
+        return {};
+
+    QMap<QString, QMap<QString, qint32> > confusion;
+    QMap<QString, qint32> predicted;
+    qint32 correct = 0;
+    qint32 unclassified = 0;
+    for (qint32 i=0; i<paths.count(); i++)
+    {
+        const QString actual = model->files.value(paths.at(i)).label;
+        const QString &result = predictions.at(i);
+        if (result.isEmpty())
+        {
+            unclassified++;
+            continue;
+        }
+
+        confusion[actual][result]++;
+        predicted[result]++;
+        if (result == actual)
+            correct++;
+    }
+
+    QVariantMap labelsMap;
+    QVariantMap confusionMap;
+    for (const QString &label: model->labelNames.strings())
+    {
+        const QMap<QString, qint32> row = confusion.value(label);
+        qint32 support = 0;
+        QVariantMap rowMap;
+        QMapIterator<QString, qint32> i(row);
+        while (i.hasNext())
+        {
+            i.next();
+            support += i.value();
+            rowMap[i.key()] = i.value();
+        }
+
+        const qint32 truePositives = row.value(label);
+        const qint32 predictedCount = predicted.value(label);
+        labelsMap[label] = QVariantMap({ {"support", support},
+                                         {"precision", predictedCount? static_cast<qreal>(truePositives) / predictedCount : 0},
+                                         {"recall", support? static_cast<qreal>(truePositives) / support : 0} });
+        confusionMap[label] = rowMap;
+    }
+
+    const qint32 evaluated = paths.count() - unclassified;
+    return { {"folds", folds}, {"files", paths.count()}, {"unclassified", unclassified}, {"correct", correct},
+             {"accuracy", evaluated? static_cast<qreal>(correct) / evaluated : 0},
+             {"labels", labelsMap}, {"confusion", confusionMap} };
+}
+
+QStringList DataFetcher::Private::expandPaths(const QStringList &paths)
+{
+    QStringList res;
+    for (const QString &path: paths)
+    {
+        QFileInfo info(path);
+        if (info.isDir())
+            res << listSource(path);
+        else
+            res << path;
+    }
+
+    return res;
+}
+
+QStringList DataFetcher::Private::listSource(const QString &source)
+{
+    // Telegram names every export result.json, so an export kept as it is
+    // sits in a directory of its own.
+    QDir dir(source);
+    QStringList res;
+    for (const QString &f: dir.entryList({"*.json"}, QDir::Files, QDir::Name))
+        res << dir.absoluteFilePath(f);
+    for (const QString &d: dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name))
+        if (QFileInfo(dir.filePath(d + "/result.json")).isFile())
+            res << dir.absoluteFilePath(d + "/result.json");
+
+    return res;
+}
+
+QString DataFetcher::Private::exportLabel(const QString &path)
+{
+    // Up to the first dot, so "Friend.json" and "Friend.2.json" train the
+    // same label. An untouched export is labeled by its directory.
+    const QFileInfo info(path);
+    if (info.fileName() == "result.json")
+        return info.absoluteDir().dirName();
+
+    return info.baseName();
+}
+
+QString DataFetcher::Private::csvField(const QString &text)
+{
+    if (!text.contains(',') && !text.contains('"') && !text.contains('\n'))
+        return text;
+
+    return '"' + QString(text).replace("\"", "\"\"") + '"';
+}
+
+bool DataFetcher::saveModel(const QString &path, bool partial)
+{
+    return Private::saveModel(*p->model, path, partial);
+}
+
+bool DataFetcher::loadModel(const QString &path)
+{
+    QSharedPointer<Private::Model> model(new Private::Model);
+    model->compact = p->compact;
+    bool partial = false;
+    if (!Private::loadModel(path, model.data(), &partial))
+        return false;
+
+    // A shard on its own is binned against its own ranges.
+    if (partial)
+    {
+        Private::TrainJob job;
+        job.fetcher = this;
+        job.resolution = model->resolution;
+        job.model = model;
+        Private::calculateFunctions(&job);
+    }
+
+    cancel();
+    p->setModel(model);
+    Q_EMIT sourceChanged();
+    return true;
+}
+
+bool DataFetcher::mergeModels(const QStringList &paths)
+{
+    Private::TrainJob job;
+    job.fetcher = this;
+    job.resolution = p->resolution;
+    job.model = QSharedPointer<Private::Model>(new Private::Model);
+    job.model->resolution = p->resolution;
+    job.model->compact = p->compact;
+
+    // Same shards and settings, same version, so cached results survive
+    // merging them again.
+    QCryptographicHash sha1(QCryptographicHash::Sha1);
+    sha1.addData(QByteArray::number(p->resolution) + (p->compact? "c" : "d"));
+    for (const QString &path: paths)
+    {
+        Private::Model partial;
+        partial.compact = p->compact;
+        if (!Private::loadModel(path, &partial, Q_NULLPTR, true) || partial.singlePass)
+            return false;
+
+        Private::merge(job.model.data(), partial);
+        sha1.addData(partial.version);
+    }
+
+    if (!Private::calculateFunctions(&job))
+        return false;
+
+    job.model->version = sha1.result();
+    job.model->updatable = false;
+
+    cancel();
+    p->setModel(job.model);
+    Q_EMIT sourceChanged();
+    return true;
+}
+
+void DataFetcher::cancel()
+{
+    if (p->batch)
+    {
+        p->batch->canceled.storeRelease(1);
+        p->retire(p->batch->future);
+        p->batch.clear();
+    }
+
+    if (p->job.isNull())
+        return;
+
+    p->job->canceled.storeRelease(1);
+    p->retire(p->job->future);
+    p->job.clear();
+    Q_EMIT trainingChanged();
+}
+
+void DataFetcher::startTraining()
+{
+    cancel();
+
+    QSharedPointer<Private::TrainJob> job(new Private::TrainJob);
+    job->fetcher = this;
+    job->pool = &p->pool;
+    job->source = p->source;
+    job->streaming = p->streaming;
+    job->singlePass = p->singlePass;
+    job->resolution = p->resolution;
+    job->memoryBudget = static_cast<qint64>(p->memoryBudget) * 1024 * 1024;
+    // Snapshots and one pass models don't keep the samples of their source
+    // files, so they can't be updated in place, and single pass training
+    // never keeps any. A new resolution or packing the values changes every
+    // bucket, so that takes a full run too.
+    const bool empty = p->model->files.isEmpty();
+    job->incremental = p->incremental && !p->singlePass && p->model->updatable &&
+                       (empty || (p->model->resolution == p->resolution && (p->model->compact || !p->compact)));
+    job->model = QSharedPointer<Private::Model>(job->incremental? new Private::Model(*p->model) : new Private::Model);
+    job->model->resolution = p->resolution;
+    if (!job->incremental || empty)
+        job->model->compact = p->compact;
+    if (!p->trace.isEmpty())
+    {
+        job->tracer = QSharedPointer<Tracer>(new Tracer);
+        job->tracePath = p->trace;
+    }
+
+    if (!p->asynchronous)
+    {
+        Private::train(job.data());
+        p->setModel(job->model);
+        Q_EMIT sourceChanged();
+        return;
+    }
+
+    p->job = job;
+    Q_EMIT trainingChanged();
+
+    QFutureWatcher<void> *watcher = new QFutureWatcher<void>(this);
+    connect(watcher, &QFutureWatcher<void>::finished, this, [this, watcher, job](){
+        watcher->deleteLater();
+        if (job->isCanceled())
+            return;
+
+        // Readers only ever see the previous model or the completed new one.
+        p->setModel(job->model);
+        p->job.clear();
+
+        Q_EMIT trainingChanged();
+        Q_EMIT sourceChanged();
+    });
+
+    job->future = QtConcurrent::run([job](){ Private::train(job.data()); });
+    watcher->setFuture(job->future);
+}
+
+void DataFetcher::Private::train(TrainJob *job)
+{
+    // Process wide, so a busy GUI thread adds to it as well.
+    const qint64 allocations = AllocationCounter::count();
+    {
+        ScopedTimer timer(&job->stats.total, job->tracer.data(), "train", job->source);
+        if (job->incremental)
+            update(job);
+        else if (job->singlePass)
+        {
+            if (accumulate(job))
+                calculateFunctions(job);
+        }
+        else if (load(job) && calculateProperties(job))
+            calculateFunctions(job);
+    }
+
+    // Histograms are only needed for binning.
+    qint64 histogramBytes = 0;
+    for (PropertyItem &pItem: job->model->properties)
+    {
+        histogramBytes += pItem.histogram.bytes();
+        pItem.histogram = StreamingHistogram();
+    }
+
+    job->model->version = trainedVersion(job->model.data());
+    job->model->stats = job->stats.toMap();
+    job->model->stats["valueBytes"] = valueBytes(job->model.data());
+    job->model->stats["histogramBytes"] = histogramBytes;
+    job->model->stats["singlePass"] = job->model->singlePass;
+    job->model->stats["arenaBytes"] = job->model->arena? job->model->arena->bytes() : 0;
+    if (AllocationCounter::isEnabled())
+        job->model->stats["allocations"] = AllocationCounter::count() - allocations;
+    job->model->stats["compact"] = job->model->compact;
+    if (job->tracer && !job->tracer->save(job->tracePath))
+        qWarning() << "Can't write the trace to" << job->tracePath;
+}
+
+QByteArray DataFetcher::Private::trainedVersion(const Model *model)
+{
+    // Same files and settings, same version, so cached results survive a
+    // restart. Size and modification time stand in for the content unless
+    // an incremental run already hashed it.
+    QStringList paths = model->files.keys();
+    paths.sort();
+
+    QCryptographicHash sha1(QCryptographicHash::Sha1);
+    sha1.addData(QByteArray::number(model->resolution) + (model->compact? "c" : "d") + (model->singlePass? "s" : "m"));
+    for (const QString &path: paths)
+    {
+        QHash<QString, FileData>::ConstIterator it = model->files.constFind(path);
+        sha1.addData(path.toUtf8());
+        sha1.addData(QByteArray::number(it->size) + ":" + QByteArray::number(it->modified));
+        sha1.addData(it->hash);
+    }
+    return sha1.result();
+}
+
+QVector<DataFetcher::Private::FileData> DataFetcher::Private::readFiles(TrainJob *job, const QStringList &paths, qint32 done, qint32 total)
+{
+    // Progress covers the whole run when the files come in batches.
+    if (!total)
+        total = paths.count();
+
+    QVector<FileData> results(paths.count());
+
+    // Files are parsed on the pool in any order, but each result lands on its
+    // own slot, so callers always merge them in the order of the given list.
+    QAtomicInt parsed(0);
+    const qint32 workers = qMin(job->pool->maxThreadCount(), paths.count());
+    if (workers <= 1)
+    {
+        for (qint32 i=0; i<paths.count() && !job->isCanceled(); i++)
+        {
+            results[i] = readFile(paths.at(i), job->streaming, job->incremental, &job->stats, job->tracer.data());
+            Q_EMIT job->fetcher->filesParsed(done+i+1, total);
+        }
+    }
+    else
+    {
+        QAtomicInt next(0);
+        FileData *data = results.data();
+        QList< QFuture<void> > futures;
+        for (qint32 w=0; w<workers; w++)
+            futures << QtConcurrent::run(job->pool, [job, &paths, data, &next, &parsed, done, total](){
+                qint32 i;
+                while (!job->isCanceled() && (i = next.fetchAndAddRelaxed(1)) < paths.count())
+                {
+                    data[i] = readFile(paths.at(i), job->streaming, job->incremental, &job->stats, job->tracer.data());
+                    Q_EMIT job->fetcher->filesParsed(done+parsed.fetchAndAddRelaxed(1)+1, total);
+                }
+            });
+
+        for (QFuture<void> &f: futures)
+            f.waitForFinished();
+    }
+
+    return results;
+}
+
+bool DataFetcher::Private::load(TrainJob *job)
+{
+    QStringList paths;
+    {
+        ScopedTimer timer(&job->stats.listing, job->tracer.data(), "list");
+        paths = listSource(job->source);
+    }
+
+    QVector<FileData> results;
+    {
+        ScopedTimer timer(Q_NULLPTR, job->tracer.data(), "read");
+        results = readFiles(job, paths);
+    }
+    if (job->isCanceled())
+        return false;
+
+    ScopedTimer timer(&job->stats.statistics, job->tracer.data(), "merge");
+    Model *model = job->model.data();
+    for (qint32 i=0; i<results.count(); i++)
+    {
+        FileData &data = results[i];
+        merge(model, data);
+
+        // The values only live on until calculateProperties.
+        FileData file = data;
+        file.ids = QVector<qint32>();
+        file.values = QVector<qreal>();
+        model->files[paths.at(i)] = file;
+    }
+
+    job->pending.swap(results);
+    model->updatable = false;
+    return true;
+}
+
+bool DataFetcher::Private::calculateProperties(TrainJob *job)
+{
+    ScopedTimer timer(&job->stats.statistics, job->tracer.data(), "statistics");
+    Model *model = job->model.data();
+    for (qint32 i=0; i<model->properties.count(); i++)
+    {
+        PropertyItem pItem;
+        pItem.property = model->propertyNames.string(i);
+        model->properties[i] = pItem;
+    }
+
+    // Columns are counted first, so each one gets its exact span of a
+    // single arena instead of a growing buffer of its own.
+    const qint32 rows = model->items.count();
+    QVector<qint32> counts(model->properties.count() * rows);
+    qint64 total = 0;
+    for (const FileData &data: job->pending)
+    {
+        if (!data.valid)
+            continue;
+
+        for (qint32 id: data.ids)
+            counts[id * rows + data.labelIndex]++;
+        total += data.ids.count();
+    }
+
+    // Packing the columns right away keeps the double ones from ever
+    // being allocated.
+    if (!model->compact && job->memoryBudget && total * static_cast<qint64>(sizeof(qreal)) > job->memoryBudget)
+        model->compact = true;
+
+    model->arena = QSharedPointer<Arena>(new Arena);
+    for (qint32 i=0; i<model->properties.count(); i++)
+    {
+        PropertyItem &pItem = model->properties[i];
+        for (qint32 label=0; label<rows; label++)
+        {
+            const qint32 count = counts.at(i * rows + label);
+            if (!count)
+                continue;
+
+            pItem.labels.resize(label+1);
+            PropertyLabel &pLabel = pItem.labels[label];
+            pLabel.labelIndex = label;
+            pLabel.values.setCompact(model->compact);
+            pLabel.values.allocate(model->arena.data(), count);
+        }
+    }
+
+    for (FileData &data: job->pending)
+    {
+        if (job->isCanceled())
+            return false;
+        if (!data.valid)
+            continue;
+
+        for (qint32 i=0; i<data.ids.count(); i++)
+            addValue(model, data.labelIndex, data.ids.at(i), data.values.at(i));
+
+        // Each file is released as soon as its values are in the columns.
+        data.ids = QVector<qint32>();
+        data.values = QVector<qreal>();
+    }
+    job->pending.clear();
+
+    for (PropertyItem &pItem: model->properties)
+        for (PropertyLabel &pLabel: pItem.labels)
+            pLabel.values.squeeze();
+
+    if (job->memoryBudget)
+        job->stats.exceedBudget(valueBytes(model) - job->memoryBudget);
+
+    return true;
+}
+
+bool DataFetcher::Private::accumulate(TrainJob *job)
+{
+    QStringList paths;
+    {
+        ScopedTimer timer(&job->stats.listing, job->tracer.data(), "list");
+        paths = listSource(job->source);
+    }
+
+    // Only a few files per worker are held at once, each one is dropped as
+    // soon as its values are in the histograms.
+    Model *model = job->model.data();
+    model->singlePass = true;
+    model->updatable = false;
+    const qint32 batch = qMax(1, job->pool->maxThreadCount()) * 4;
+    for (qint32 first=0; first<paths.count(); first+=batch)
+    {
+        const QStringList part = paths.mid(first, batch);
+        QVector<FileData> results;
+        {
+            ScopedTimer timer(Q_NULLPTR, job->tracer.data(), "read");
+            results = readFiles(job, part, first, paths.count());
+        }
+        if (job->isCanceled())
+            return false;
+
+        ScopedTimer timer(&job->stats.statistics, job->tracer.data(), "histograms");
+        for (qint32 i=0; i<results.count(); i++)
+        {
+            FileData &data = results[i];
+            merge(model, data);
+            for (qint32 v=0; v<data.ids.count(); v++)
+                addSample(model, data.labelIndex, data.ids.at(v), data.values.at(v));
+
+            data.ids = QVector<qint32>();
+            data.values = QVector<qreal>();
+            model->files[part.at(i)] = data;
+        }
+    }
+
+    return true;
+}
+
+bool DataFetcher::Private::calculateFunctions(TrainJob *job)
+{
+    ScopedTimer timer(&job->stats.binning, job->tracer.data(), "binning");
+    Model *model = job->model.data();
+    const qint32 rows = model->items.count();
+    for (qint32 i=0; i<model->properties.count(); i++)
+    {
+        if (job->isCanceled())
+            return false;
+
+        Q_EMIT job->fetcher->propertiesBinned(i+1, model->properties.count());
+
+        PropertyItem &pItem = model->properties[i];
+        if (!pItem.hasRange())
+        {
+            pItem.functions.clear();
+            pItem.scores.clear();
+            continue;
+        }
+
+        ScopedTimer propertyTimer(Q_NULLPTR, job->tracer.data(), "property", pItem.property);
+        pItem.resolution = chooseResolution(pItem, job->resolution);
+        pItem.functions.resize(rows, pItem.resolution);
+        pItem.scores.resize(pItem.resolution+1, rows);
+
+        for (const PropertyLabel &pLabel: pItem.labels)
+            if (pLabel.isValid())
+                calculateFunction(pItem, pLabel);
+    }
+
+    return true;
+}
+
+void DataFetcher::Private::merge(Model *model, FileData &data)
+{
+    if (!data.valid)
+        return;
+
+    data.labelIndex = model->internLabel(data.label);
+
+    QVector<qint32> ids;
+    ids.reserve(data.properties.count());
+    for (const QString &property: data.properties)
+        ids << model->internProperty(property);
+
+    for (qint32 &id: data.ids)
+        id = ids.at(id);
+
+    data.properties.clear();
+}
+
+void DataFetcher::Private::merge(Model *model, const Model &partial)
+{
+    // Ids of the partial model are mapped to the merged one, and adding
+    // every value again rebuilds the ranges and sums of the union.
+    QVector<qint32> labels;
+    labels.reserve(partial.items.count());
+    for (const DataItem &item: partial.items)
+    {
+        const bool added = model->labelNames.id(item.label) < 0;
+        labels << model->internLabel(item.label);
+        if (added)
+            model->items.last().color = item.color;
+    }
+
+    for (const PropertyItem &source: partial.properties)
+    {
+        const qint32 property = model->internProperty(source.property);
+        for (const PropertyLabel &pLabel: source.labels)
+        {
+            if (!pLabel.isValid())
+                continue;
+
+            const qint32 label = labels.at(pLabel.labelIndex);
+            for (qint32 i=0; i<pLabel.values.count(); i++)
+                addValue(model, label, property, pLabel.values.at(i));
+        }
+    }
+}
+
+void DataFetcher::Private::addValue(Model *model, qint32 label, qint32 property, qreal value)
+{
+    PropertyItem &pItem = model->properties[property];
+    if (pItem.labels.count() <= label)
+        pItem.labels.resize(label+1);
+
+    PropertyLabel &pLabel = pItem.labels[label];
+    if (!pLabel.isValid())
+        pLabel.values.setCompact(model->compact);
+    pLabel.labelIndex = label;
+
+    // Statistics follow the stored value, so a compact column agrees with
+    // its own range.
+    value = pLabel.values.stored(value);
+    pItem.sum += value;
+    pItem.count++;
+    if (pItem.maximum < value) pItem.maximum = value;
+    if (pItem.minimum > value) pItem.minimum = value;
+
+    pLabel.values.append(value);
+}
+
+void DataFetcher::Private::addSample(Model *model, qint32 label, qint32 property, qreal value)
+{
+    PropertyItem &pItem = model->properties[property];
+    if (pItem.labels.count() <= label)
+        pItem.labels.resize(label+1);
+
+    PropertyLabel &pLabel = pItem.labels[label];
+    pLabel.labelIndex = label;
+    pLabel.samples++;
+
+    pItem.sum += value;
+    pItem.count++;
+    if (pItem.maximum < value) pItem.maximum = value;
+    if (pItem.minimum > value) pItem.minimum = value;
+
+    pItem.histogram.add(label, value);
+}
+
+void DataFetcher::Private::pack(Model *model, Changes *changes)
+{
+    // Rounding moves the ranges and sums, so they follow the float values
+    // and every packed label is binned again.
+    model->compact = true;
+    for (qint32 property=0; property<model->properties.count(); property++)
+    {
+        PropertyItem &pItem = model->properties[property];
+        for (const PropertyLabel &pLabel: pItem.labels)
+            if (pLabel.isValid())
+                changes->touch(model, property, pLabel.labelIndex);
+
+        pItem.sum = 0;
+        pItem.minimum = INT_MAX;
+        pItem.maximum = INT_MIN;
+        for (PropertyLabel &pLabel: pItem.labels)
+        {
+            pLabel.values.setCompact(true);
+            pLabel.values.squeeze();
+            for (qint32 i=0; i<pLabel.values.count(); i++)
+            {
+                const qreal value = pLabel.values.at(i);
+                pItem.sum += value;
+                if (pItem.maximum < value) pItem.maximum = value;
+                if (pItem.minimum > value) pItem.minimum = value;
+            }
+        }
+    }
+}
+
+qint64 DataFetcher::Private::valueBytes(const Model *model)
+{
+    qint64 res = 0;
+    for (const PropertyItem &pItem: model->properties)
+        for (const PropertyLabel &pLabel: pItem.labels)
+            res += pLabel.values.bytes();
+    return res;
+}
+
+bool DataFetcher::Private::removeValue(Model *model, qint32 label, qint32 property, qreal value)
+{
+    PropertyItem &pItem = model->properties[property];
+    if (!pItem.contains(label))
+        return false;
+
+    PropertyLabel &pLabel = pItem.labels[label];
+    value = pLabel.values.stored(value);
+    if (!pLabel.values.removeOne(value))
+        return false;
+
+    pItem.sum -= value;
+    pItem.count--;
+    if (pLabel.values.isEmpty())
+        pLabel = PropertyLabel();
+
+    // The caller has to rescan the range when an edge value goes away.
+    return value <= pItem.minimum || value >= pItem.maximum;
+}
+
+void DataFetcher::Private::calculateFunction(PropertyItem &pItem, const PropertyLabel &pLabel)
+{
+    if (!pItem.hasRange())
+    {
+        pItem.functions.clear();
+        pItem.scores.clear();
+        return;
+    }
+
+    const qint32 resolution = pItem.resolution;
+    const qint32 label = pLabel.labelIndex;
+    if (pItem.functions.columns() != resolution)
+        pItem.functions.resize(label+1, resolution);
+    else
+        pItem.functions.reserveRows(label+1);
+
+    qreal *function = pItem.functions.row(label);
+    memset(function, 0, resolution * sizeof(qreal));
+
+    if (!pItem.histogram.isEmpty())
+        pItem.histogram.bin(label, pItem.minimum, pItem.maximum, function, resolution);
+
+    bool minimumOccupied = false;
+    for (qint32 i=0; i<pLabel.values.count(); i++)
+    {
+        qreal normalValue = (pLabel.values.at(i) - pItem.minimum) / (pItem.maximum - pItem.minimum);
+        qint32 index = normalValue * resolution;
+        if (index == resolution) index--;
+
+        function[index] += (normalValue / pLabel.values.count());
+        if (normalValue == 0)
+            minimumOccupied = true;
+    }
+
+    // Writing the label may detach the labels, and pLabel can point into
+    // the shared copy.
+    PropertyLabel &target = pItem.labels[label];
+    target.minimumOccupied = minimumOccupied;
+    indexNeighbours(target, function, resolution);
+    calculateScores(pItem, target);
+}
+
+void DataFetcher::Private::indexNeighbours(PropertyLabel &pLabel, const qreal *function, qint32 resolution)
+{
+    pLabel.previous.resize(resolution);
+    pLabel.next.resize(resolution);
+
+    qint16 last = -1;
+    for (qint32 i=0; i<resolution; i++)
+    {
+        pLabel.previous[i] = last;
+        if (pLabel.isOccupied(function, i))
+            last = static_cast<qint16>(i);
+    }
+
+    last = static_cast<qint16>(resolution);
+    for (qint32 i=resolution-1; i>=0; i--)
+    {
+        pLabel.next[i] = last;
+        if (pLabel.isOccupied(function, i))
+            last = static_cast<qint16>(i);
+    }
+}
+
+void DataFetcher::Private::clearFunction(PropertyItem &pItem, qint32 label)
+{
+    if (label < pItem.labels.count())
+    {
+        pItem.labels[label].previous.clear();
+        pItem.labels[label].next.clear();
+        pItem.labels[label].minimumOccupied = false;
+    }
+
+    if (label < pItem.functions.rows())
+        pItem.functions.clearRow(label);
+
+    if (label < pItem.scores.columns())
+    {
+        const qint32 stride = pItem.scores.stride();
+        qreal *score = pItem.scores.row(0) + label;
+        for (qint32 index=0; index<=pItem.resolution; index++)
+            score[index*stride] = 0;
+    }
+}
+
+void DataFetcher::Private::calculateScores(PropertyItem &pItem, const PropertyLabel &pLabel)
+{
+    if (pItem.scores.rows() != pItem.resolution+1)
+        pItem.scores.resize(pItem.resolution+1, pItem.functions.rows());
+    else
+        pItem.scores.reserveColumns(pItem.functions.rows());
+
+    const qreal *function = pItem.functions.row(pLabel.labelIndex);
+    const qint32 stride = pItem.scores.stride();
+    qreal *score = pItem.scores.row(0) + pLabel.labelIndex;
+
+    switch (pItem.resolution)
+    {
+    case 64:   smoothFunction<64>(function, score, stride, 64); break;
+    case 128:  smoothFunction<128>(function, score, stride, 128); break;
+    case 256:  smoothFunction<256>(function, score, stride, 256); break;
+    case 512:  smoothFunction<512>(function, score, stride, 512); break;
+    case 1000: smoothFunction<1000>(function, score, stride, 1000); break;
+    case 1024: smoothFunction<1024>(function, score, stride, 1024); break;
+    case 2048: smoothFunction<2048>(function, score, stride, 2048); break;
+    case 4096: smoothFunction<4096>(function, score, stride, 4096); break;
+    default:   smoothFunction<0>(function, score, stride, pItem.resolution); break;
+    }
+}
+
+/*
+ * Same kernel as calculateRate_2, evaluated once for every index a value
+ * inside [minimum, maximum] can fall on. N is the resolution when it is
+ * known at compile time, 0 for any other size.
+ */
+template<qint32 N>
+void DataFetcher::Private::smoothFunction(const qreal *function, qreal *score, qint32 stride, qint32 resolution)
+{
+    const qint32 n = (N? N : resolution);
+    const qreal *weights = smoothingWeights();
+    for (qint32 index=0; index<=n; index++)
+        score[index*stride] = 0;
+
+    for (qint32 i=0; i<n; i++)
+    {
+        const qreal rate = function[i];
+        if (rate == 0)
+            continue;
+
+        for (qint32 index=0; index<=n; index++)
+            score[index*stride] += rate * weights[qAbs(i - index)];
+    }
+}
+
+const qreal *DataFetcher::Private::smoothingWeights()
+{
+    static const QVector<qreal> weights = [](){
+        QVector<qreal> res(MAXIMUM_RESOLUTION+1);
+        for (qint32 i=0; i<=MAXIMUM_RESOLUTION; i++)
+            res[i] = 1.0 / qPow(i + 1, 4);
+        return res;
+    }();
+    return weights.constData();
+}
+
+qint32 DataFetcher::Private::chooseResolution(const PropertyItem &pItem, qint32 resolution)
+{
+    if (resolution > 0)
+        return qBound(MINIMUM_RESOLUTION, resolution, MAXIMUM_RESOLUTION);
+
+    // A single pass model has no values, its quartiles come from the
+    // histogram instead.
+    const StreamingHistogram &histogram = pItem.histogram;
+    QVector<qreal> values;
+    if (histogram.isEmpty())
+    {
+        values.reserve(pItem.count);
+        for (const PropertyLabel &pLabel: pItem.labels)
+            for (qint32 i=0; i<pLabel.values.count(); i++)
+                values << pLabel.values.at(i);
+    }
+
+    auto quantile = [&values, &histogram](qreal q) -> qreal {
+        if (values.isEmpty())
+            return histogram.quantile(q);
+
+        QVector<qreal>::iterator nth = values.begin() + static_cast<qint32>(q * (values.count() - 1));
+        std::nth_element(values.begin(), nth, values.end());
+        return *nth;
+    };
+
+    // Freedman-Diaconis bin width, or the square root rule when half of
+    // the values sit on one point.
+    const qint32 count = values.isEmpty()? pItem.count : values.count();
+    const qreal iqr = quantile(0.75) - quantile(0.25);
+    const qreal bins = (iqr > 0? (pItem.maximum - pItem.minimum) * qPow(count, 1.0/3) / (2 * iqr) : qSqrt(count));
+
+    // Rounded up to a power of two, so a specialized kernel applies.
+    qint32 res = 64;
+    while (res < bins && res < MAXIMUM_RESOLUTION)
+        res *= 2;
+    return res;
+}
+
+bool DataFetcher::Private::update(TrainJob *job)
+{
+    Model *model = job->model.data();
+
+    QStringList changed;
+    QStringList removed;
+    {
+        ScopedTimer timer(&job->stats.listing, job->tracer.data(), "list");
+
+        QSet<QString> present;
+        for (const QString &path: listSource(job->source))
+        {
+            present.insert(path);
+
+            QFileInfo info(path);
+            QHash<QString, FileData>::ConstIterator it = model->files.constFind(path);
+            if (it != model->files.constEnd() && it->size == info.size() &&
+                it->modified == info.lastModified().toMSecsSinceEpoch())
+                continue;
+
+            changed << path;
+        }
+
+        for (QHash<QString, FileData>::ConstIterator it = model->files.constBegin(); it != model->files.constEnd(); it++)
+            if (!present.contains(it.key()))
+                removed << it.key();
+        std::sort(removed.begin(), removed.end());
+    }
+
+    QVector<FileData> results;
+    {
+        ScopedTimer timer(Q_NULLPTR, job->tracer.data(), "read");
+        results = readFiles(job, changed);
+    }
+    if (job->isCanceled())
+        return false;
+
+    Changes changes;
+    {
+        ScopedTimer timer(&job->stats.statistics, job->tracer.data(), "statistics");
+
+        for (const QString &path: removed)
+            removeFile(model, model->files.take(path), &changes);
+
+        for (qint32 i=0; i<changed.count(); i++)
+        {
+            FileData &data = results[i];
+            const QString &path = changed.at(i);
+
+            QHash<QString, FileData>::Iterator it = model->files.find(path);
+            if (it != model->files.end())
+            {
+                if (!it->hash.isEmpty() && it->hash == data.hash)
+                {
+                    it->size = data.size;
+                    it->modified = data.modified;
+                    continue;
+                }
+
+                removeFile(model, *it, &changes);
+            }
+
+            addFile(model, data, &changes);
+            model->files[path] = data;
+        }
+
+        // Same budget as a full run, the columns are packed once the added
+        // values push them over it.
+        if (job->memoryBudget && !model->compact && valueBytes(model) > job->memoryBudget)
+            pack(model, &changes);
+        if (job->memoryBudget)
+            job->stats.exceedBudget(valueBytes(model) - job->memoryBudget);
+
+        rescanRanges(model, changes);
+    }
+
+    ScopedTimer timer(&job->stats.binning, job->tracer.data(), "binning");
+    return rebin(model, changes, job->resolution, job);
+}
+
+void DataFetcher::Private::Changes::touch(const Model *model, qint32 property, qint32 label)
+{
+    if (!ranges.contains(property))
+    {
+        const PropertyItem &pItem = model->properties.at(property);
+        ranges[property] = qMakePair(pItem.minimum, pItem.maximum);
+    }
+    dirtyLabels[property].insert(label);
+}
+
+void DataFetcher::Private::addFile(Model *model, FileData &data, Changes *changes)
+{
+    merge(model, data);
+    if (!data.valid)
+        return;
+
+    for (qint32 i=0; i<data.ids.count(); i++)
+    {
+        changes->touch(model, data.ids.at(i), data.labelIndex);
+        addValue(model, data.labelIndex, data.ids.at(i), data.values.at(i));
+    }
+}
+
+void DataFetcher::Private::removeFile(Model *model, const FileData &data, Changes *changes)
+{
+    if (!data.valid)
+        return;
+
+    for (qint32 i=0; i<data.ids.count(); i++)
+    {
+        const qint32 property = data.ids.at(i);
+        changes->touch(model, property, data.labelIndex);
+        if (removeValue(model, data.labelIndex, property, data.values.at(i)))
+            changes->rescan.insert(property);
+    }
+}
+
+void DataFetcher::Private::rescanRanges(Model *model, const Changes &changes)
+{
+    for (qint32 property: changes.rescan)
+    {
+        PropertyItem &pItem = model->properties[property];
+        pItem.minimum = INT_MAX;
+        pItem.maximum = INT_MIN;
+        for (const PropertyLabel &pLabel: pItem.labels)
+            for (qint32 i=0; i<pLabel.values.count(); i++)
+            {
+                const qreal value = pLabel.values.at(i);
+                if (pItem.maximum < value) pItem.maximum = value;
+                if (pItem.minimum > value) pItem.minimum = value;
+            }
+    }
+}
+
+bool DataFetcher::Private::rebin(Model *model, const Changes &changes, qint32 resolution, TrainJob *job)
+{
+    qint32 binned = 0;
+    QHashIterator<qint32, QPair<qreal, qreal> > ir(changes.ranges);
+    while (ir.hasNext())
+    {
+        ir.next();
+        if (job)
+        {
+            if (job->isCanceled())
+                return false;
+            Q_EMIT job->fetcher->propertiesBinned(++binned, changes.ranges.count());
+        }
+
+        PropertyItem &pItem = model->properties[ir.key()];
+        if (pItem.minimum != ir.value().first || pItem.maximum != ir.value().second)
+        {
+            if (pItem.hasRange())
+                pItem.resolution = chooseResolution(pItem, resolution);
+            pItem.functions.clear();
+            pItem.scores.clear();
+            for (const PropertyLabel &pLabel: pItem.labels)
+                if (pLabel.isValid())
+                    calculateFunction(pItem, pLabel);
+        }
+        else
+        {
+            for (qint32 label: changes.dirtyLabels.value(ir.key()))
+            {
+                if (pItem.contains(label))
+                    calculateFunction(pItem, pItem.labels.at(label));
+                else
+                    clearFunction(pItem, label);
+            }
+        }
+    }
+
+    return true;
+}
+
+DataFetcher::~DataFetcher()
+{
+    cancel();
+    for (QFuture<void> &future: p->retired)
+        future.waitForFinished();
+
+    delete p;
+}
+
+bool DataFetcher::Private::readMonths(const QString &path, bool streaming, QString *label, MonthMap *months,
+                                     qint64 *readTime, qint64 *bytesRead, QByteArray *hash)
+{
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    // Asked for a hash, the streaming readers go through a device that
+    // hashes what they read, so the file is still read only once.
+    HashingDevice hashing(&file);
+    QIODevice *device = hash? static_cast<QIODevice*>(&hashing) : &file;
+
+    // Summaries are a top level array, raw Telegram exports an object. An
+    // export can be several GB, so it is always streamed, and named after
+    // its label since it doesn't carry one.
+    const QByteArray head = file.peek(64).trimmed();
+    if (head.startsWith('{'))
+    {
+        MonthMap result;
+        TelegramExportReader reader(device);
+        bool ok = reader.read([&result](const QString &, const QString &month, const QString &property, qreal value){
+            result[month][property] = value;
+        });
+        if (hash)
+            *hash = hashing.result();
+
+        if (readTime) *readTime += reader.readTime();
+        if (bytesRead) *bytesRead += reader.bytesRead();
+
+        if (!ok)
+            qWarning() << "Can't read the export" << path << "-" << reader.errorString();
+        if (!ok || !reader.hasChat())
+            return false;
+
+        if (label)
+            *label = exportLabel(path);
+        *months = result;
+        return true;
+    }
+
+    if (streaming)
+    {
+        MonthMap result;
+        JsonStreamReader reader(device);
+        bool ok = reader.read([&result](const QString &, const QString &month, const QString &property, qreal value){
+            result[month][property] = value;
+        });
+        if (hash)
+            *hash = hashing.result();
+
+        if (readTime) *readTime += reader.readTime();
+        if (bytesRead) *bytesRead += reader.bytesRead();
+
+        if (ok)
+        {
+            if (!reader.hasRecord())
+                return false;
+            if (label)
+                *label = reader.label();
+            *months = result;
+            return true;
+        }
+
+        qWarning() << path << reader.errorString() << "- falling back to QJsonDocument";
+        file.seek(0);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QByteArray data = file.readAll();
+    if (readTime) *readTime += timer.nsecsElapsed();
+    if (bytesRead) *bytesRead += data.size();
+    if (hash) *hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+
+    QVariantList list = QJsonDocument::fromJson(data).toVariant().toList();
+    if (list.isEmpty())
+        return false;
+
+    QVariantMap map = list.first().toMap();
+    if (label)
+        *label = map.value("label").toString();
+
+    QVariantMap monthsMap = map.value("months").toMap();
+    QMapIterator<QString, QVariant> im(monthsMap);
+    while (im.hasNext())
+    {
+        im.next();
+        QVariantMap sum = im.value().toMap().value("sum").toMap();
+
+        QMapIterator<QString, QVariant> i(sum);
+        while (i.hasNext())
+        {
+            i.next();
+            switch (static_cast<qint32>(i.value().type()))
+            {
+            case QVariant::Map:
+            case QVariant::List:
+                continue;
+            }
+
+            bool ok = false;
+            qreal value = i.value().toReal(&ok);
+            if (!ok) continue;
+
+            (*months)[im.key()][i.key()] = value;
+        }
+    }
+
+    return true;
+}
+
+DataFetcher::Private::FileData DataFetcher::Private::readFile(const QString &path, bool streaming, bool hash, TrainStats *stats, Tracer *tracer)
+{
+    ScopedTimer fileTimer(Q_NULLPTR, tracer, "file", path);
+    FileData res;
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 readTime = 0;
+    qint64 bytesRead = 0;
+
+    QFileInfo info(path);
+    res.size = info.size();
+    res.modified = info.lastModified().toMSecsSinceEpoch();
+
+    MonthMap months;
+    const bool ok = readMonths(path, streaming, &res.label, &months, &readTime, &bytesRead, hash? &res.hash : Q_NULLPTR);
+    if (stats)
+    {
+        stats->files.fetchAndAddRelaxed(1);
+        stats->bytesRead.fetchAndAddRelaxed(bytesRead);
+        stats->reading.fetchAndAddRelaxed(readTime);
+        stats->parsing.fetchAndAddRelaxed(timer.nsecsElapsed() - readTime);
+        if (!ok)
+            stats->filesFailed.fetchAndAddRelaxed(1);
+        else if (res.label.contains("!"))
+            stats->filesSkipped.fetchAndAddRelaxed(1);
+    }
+
+    if (!ok)
+        return res;
+
+//    res.label.remove("!");
+    if (res.label.contains("!"))
+        return res;
+
+    // The maps repeat every property name in every month. Flat arrays with
+    // file local ids are much smaller, and merge() maps the ids later.
+    qint32 count = 0;
+    for (const SumMap &sum: months)
+        count += sum.count();
+    res.ids.reserve(count);
+    res.values.reserve(count);
+
+    QHash<QString, qint32> ids;
+    for (const SumMap &sum: months)
+    {
+        QMapIterator<QString, qreal> i(sum);
+        while (i.hasNext())
+        {
+            i.next();
+            qint32 id = ids.value(i.key(), -1);
+            if (id < 0)
+            {
+                id = res.properties.count();
+                ids.insert(i.key(), id);
+                res.properties << i.key();
+            }
+
+            res.ids << id;
+            res.values << i.value();
+        }
+    }
+
+    res.valid = true;
+    return res;
+}
+
+bool DataFetcher::Private::saveModel(const Model &model, const QString &path, bool partial)
+{
+    Q_STATIC_ASSERT(sizeof(SnapshotHeader) == 64);
+    Q_STATIC_ASSERT(sizeof(SnapshotLabel) == 16);
+    Q_STATIC_ASSERT(sizeof(SnapshotProperty) == 56);
+    Q_STATIC_ASSERT(sizeof(SnapshotEntry) == 32);
+    Q_STATIC_ASSERT(sizeof(SnapshotBin) == 16);
+
+    // Merging needs the values, which a single pass model never kept.
+    if (partial && model.singlePass)
+        return false;
+
+    QByteArray strings;
+    auto addString = [&strings](const QString &str, quint32 *offset, quint32 *size) {
+        const QByteArray utf8 = str.toUtf8();
+        *offset = static_cast<quint32>(strings.size());
+        *size = static_cast<quint32>(utf8.size());
+        strings += utf8;
+    };
+
+    QVector<SnapshotLabel> labels;
+    for (const DataItem &item: model.items)
+    {
+        SnapshotLabel l;
+        addString(item.label, &l.nameOffset, &l.nameSize);
+        l.color = item.color;
+        l.index = item.index;
+        labels << l;
+    }
+
+    QVector<SnapshotProperty> properties;
+    QVector<SnapshotEntry> entries;
+    QVector<SnapshotBin> bins;
+    QVector<double> scores;
+    QVector<double> values;
+    for (const PropertyItem &pItem: model.properties)
+    {
+        if (!pItem.count)
+            continue;
+
+        SnapshotProperty sp;
+        addString(pItem.property, &sp.nameOffset, &sp.nameSize);
+        sp.firstEntry = static_cast<quint32>(entries.count());
+        sp.entriesCount = 0;
+        sp.resolution = static_cast<quint32>(pItem.resolution);
+        sp.flags = partial? SNAPSHOT_UNBINNED : 0;
+        sp.minimum = pItem.minimum;
+        sp.maximum = pItem.maximum;
+        sp.sum = pItem.sum;
+        sp.firstScore = static_cast<quint64>(scores.count());
+
+        // Every label gets a column, so the rows load back with one copy each.
+        if (!partial && pItem.scores.rows() == pItem.resolution+1)
+        {
+            sp.flags |= SNAPSHOT_SCORED;
+            const qint32 columns = qMin(pItem.scores.columns(), model.items.count());
+            for (qint32 r=0; r<=pItem.resolution; r++)
+            {
+                const qreal *row = pItem.scores.row(r);
+                for (qint32 c=0; c<model.items.count(); c++)
+                    scores << (c < columns? row[c] : 0);
+            }
+        }
+        properties << sp;
+
+        for (const PropertyLabel &pLabel: pItem.labels)
+        {
+            if (!pLabel.isValid())
+                continue;
+
+            SnapshotEntry e;
+            e.label = static_cast<quint32>(pLabel.labelIndex);
+            e.binsCount = 0;
+            e.valuesCount = static_cast<quint32>(pLabel.values.count());
+            e.samples = static_cast<quint32>(pLabel.samples);
+            e.firstBin = static_cast<quint64>(bins.count());
+            e.firstValue = static_cast<quint64>(values.count());
+
+            if (!partial && pLabel.labelIndex < pItem.functions.rows())
+            {
+                const qreal *function = pLabel.function(pItem);
+                for (qint32 i=0; i<pItem.resolution; i++)
+                {
+                    if (!pLabel.isOccupied(function, i))
+                        continue;
+
+                    SnapshotBin b;
+                    b.index = i;
+                    b.reserved = 0;
+                    b.value = function[i];
+                    bins << b;
+                    e.binsCount++;
+                }
+            }
+
+            entries << e;
+            properties.last().entriesCount++;
+
+            for (qint32 v=0; v<pLabel.values.count(); v++)
+                values << pLabel.values.at(v);
+        }
+    }
+
+    while (strings.size() % 8)
+        strings += '\0';
+
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.labelsCount = static_cast<quint32>(labels.count());
+    header.propertiesCount = static_cast<quint32>(properties.count());
+    header.entriesCount = static_cast<quint32>(entries.count());
+    header.resolution = model.resolution;
+    header.binsCount = static_cast<quint64>(bins.count());
+    header.scoresCount = static_cast<quint64>(scores.count());
+    header.valuesCount = static_cast<quint64>(values.count());
+    header.stringsSize = static_cast<quint64>(strings.size());
+
+    QSaveFile file(path);
+    if (!file.open(QFile::WriteOnly))
+        return false;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(labels.constData()), labels.count() * sizeof(SnapshotLabel));
+    file.write(reinterpret_cast<const char*>(properties.constData()), properties.count() * sizeof(SnapshotProperty));
+    file.write(reinterpret_cast<const char*>(entries.constData()), entries.count() * sizeof(SnapshotEntry));
+    file.write(reinterpret_cast<const char*>(bins.constData()), bins.count() * sizeof(SnapshotBin));
+    file.write(reinterpret_cast<const char*>(scores.constData()), scores.count() * sizeof(double));
+    file.write(reinterpret_cast<const char*>(values.constData()), values.count() * sizeof(double));
+    file.write(strings);
+
+    return file.commit();
+}
+
+bool DataFetcher::Private::loadModel(const QString &path, Model *model, bool *partial, bool merging)
+{
+    // The model keeps the file open, its value columns read the mapping.
+    QSharedPointer<QFile> file(new QFile(path));
+    if (!file->open(QFile::ReadOnly))
+        return false;
+
+    const qint64 size = file->size();
+    if (size < static_cast<qint64>(sizeof(SnapshotHeader)))
+        return false;
+
+    const char *data = reinterpret_cast<const char*>(file->map(0, size));
+    if (data)
+        model->snapshot = file;
+    else
+    {
+        model->snapshotData = file->readAll();
+        data = model->snapshotData.constData();
+    }
+
+    const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader*>(data);
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->byteOrder != SNAPSHOT_BYTE_ORDER)
+        return false;
+
+    // 0 is adaptive, anything else is what the properties were binned at.
+    if (header->resolution != 0 &&
+        (header->resolution < MINIMUM_RESOLUTION || header->resolution > MAXIMUM_RESOLUTION))
+        return false;
+
+    const quint64 labelsOffset = sizeof(SnapshotHeader);
+    const quint64 propertiesOffset = labelsOffset + header->labelsCount * sizeof(SnapshotLabel);
+    const quint64 entriesOffset = propertiesOffset + header->propertiesCount * sizeof(SnapshotProperty);
+    const quint64 binsOffset = entriesOffset + header->entriesCount * sizeof(SnapshotEntry);
+    const quint64 scoresOffset = binsOffset + header->binsCount * sizeof(SnapshotBin);
+    const quint64 valuesOffset = scoresOffset + header->scoresCount * sizeof(double);
+    const quint64 stringsOffset = valuesOffset + header->valuesCount * sizeof(double);
+    if (stringsOffset + header->stringsSize != static_cast<quint64>(size))
+        return false;
+
+    // Scoring never reads the values, so they only count towards the
+    // version of a merge, and a plain load doesn't have to touch them.
+    QCryptographicHash sha1(QCryptographicHash::Sha1);
+    auto addData = [&sha1, data](quint64 from, quint64 to) {
+        for (quint64 offset=from; offset<to; offset += 1 << 30)
+            sha1.addData(data + offset, static_cast<int>(qMin<quint64>(to - offset, 1 << 30)));
+    };
+    addData(0, valuesOffset);
+    if (merging)
+        addData(valuesOffset, stringsOffset);
+    addData(stringsOffset, static_cast<quint64>(size));
+    model->version = sha1.result();
+
+    const SnapshotLabel *labels = reinterpret_cast<const SnapshotLabel*>(data + labelsOffset);
+    const SnapshotProperty *properties = reinterpret_cast<const SnapshotProperty*>(data + propertiesOffset);
+    const SnapshotEntry *entries = reinterpret_cast<const SnapshotEntry*>(data + entriesOffset);
+    const SnapshotBin *bins = reinterpret_cast<const SnapshotBin*>(data + binsOffset);
+    const double *scores = reinterpret_cast<const double*>(data + scoresOffset);
+    const double *values = reinterpret_cast<const double*>(data + valuesOffset);
+    const char *strings = data + stringsOffset;
+
+    auto string = [strings, header](quint32 offset, quint32 size, QString *res) -> bool {
+        if (static_cast<quint64>(offset) + size > header->stringsSize)
+            return false;
+        *res = QString::fromUtf8(strings + offset, static_cast<int>(size));
+        return true;
+    };
+
+    // Ids are the record positions, so interning the names in file order
+    // has to hand them out again one by one.
+    const qint32 rows = static_cast<qint32>(header->labelsCount);
+    for (quint32 i=0; i<header->labelsCount; i++)
+    {
+        const SnapshotLabel &l = labels[i];
+        DataItem item;
+        if (!string(l.nameOffset, l.nameSize, &item.label) || l.index != static_cast<qint32>(i) ||
+            model->labelNames.intern(item.label) != l.index)
+            return false;
+
+        item.color = l.color;
+        item.index = l.index;
+        model->items << item;
+    }
+
+    for (quint32 i=0; i<header->propertiesCount; i++)
+    {
+        const SnapshotProperty &sp = properties[i];
+        if (static_cast<quint64>(sp.firstEntry) + sp.entriesCount > header->entriesCount)
+            return false;
+
+        PropertyItem pItem;
+        if (!string(sp.nameOffset, sp.nameSize, &pItem.property))
+            return false;
+
+        if (model->propertyNames.intern(pItem.property) != model->properties.count())
+            return false;
+
+        if (sp.resolution < MINIMUM_RESOLUTION || sp.resolution > MAXIMUM_RESOLUTION)
+            return false;
+
+        pItem.minimum = sp.minimum;
+        pItem.maximum = sp.maximum;
+        pItem.sum = sp.sum;
+        pItem.resolution = static_cast<qint32>(sp.resolution);
+        pItem.labels.resize(rows);
+        if (sp.flags & SNAPSHOT_UNBINNED)
+        {
+            if (partial)
+                *partial = true;
+        }
+        else if (pItem.minimum != pItem.maximum)
+        {
+            pItem.functions.resize(rows, pItem.resolution);
+            pItem.scores.resize(pItem.resolution+1, rows);
+        }
+
+        for (quint32 j=sp.firstEntry; j<sp.firstEntry + sp.entriesCount; j++)
+        {
+            const SnapshotEntry &e = entries[j];
+            if (e.label >= header->labelsCount ||
+                e.firstBin + e.binsCount > header->binsCount ||
+                e.firstValue + e.valuesCount > header->valuesCount)
+                return false;
+
+            PropertyLabel &pLabel = pItem.labels[static_cast<int>(e.label)];
+            if (pLabel.isValid())
+                return false;
+
+            pLabel.labelIndex = static_cast<qint32>(e.label);
+
+            for (quint64 b=e.firstBin; b<e.firstBin + e.binsCount; b++)
+            {
+                if (bins[b].index < 0 || bins[b].index >= pItem.resolution || pItem.functions.isEmpty())
+                    return false;
+                pItem.functions.row(pLabel.labelIndex)[bins[b].index] = bins[b].value;
+                if (bins[b].index == 0 && bins[b].value == 0)
+                    pLabel.minimumOccupied = true;
+            }
+
+            if (e.valuesCount)
+                pLabel.values.borrow(values + e.firstValue, static_cast<qint32>(e.valuesCount));
+
+            if (!e.valuesCount && e.samples)
+            {
+                pLabel.samples = static_cast<qint32>(e.samples);
+                model->singlePass = true;
+            }
+            pItem.count += pLabel.count();
+            if (!pItem.functions.isEmpty())
+            {
+                indexNeighbours(pLabel, pLabel.function(pItem), pItem.resolution);
+                if (!(sp.flags & SNAPSHOT_SCORED))
+                    calculateScores(pItem, pLabel);
+            }
+        }
+
+        if ((sp.flags & SNAPSHOT_SCORED) && !pItem.functions.isEmpty())
+        {
+            const quint64 count = static_cast<quint64>(pItem.resolution+1) * header->labelsCount;
+            if (sp.firstScore + count > header->scoresCount)
+                return false;
+
+            const double *score = scores + sp.firstScore;
+            for (qint32 r=0; r<=pItem.resolution; r++, score += rows)
+                memcpy(pItem.scores.row(r), score, rows * sizeof(double));
+        }
+
+        model->properties << pItem;
+    }
+
+    model->resolution = header->resolution;
+    model->updatable = false;
+    return true;
+}
+
+qreal DataFetcher::Private::PropertyLabel::checkRate(const PropertyItem &pItem, qreal value, Scorer scorer) const
+{
+    return scorer == LinearScorer? calculateRate_1(pItem, value) : calculateRate_2(pItem, value);
+}
+
+qreal DataFetcher::Private::PropertyLabel::calculateRate_1(const PropertyItem &pItem, qreal value) const
+{
+    const qreal *function = this->function(pItem);
+
+    qint32 index = pItem.index(value);
+    if (index >= 0 && index < pItem.resolution && isOccupied(function, index))
+        return function[index];
+
+    // Outside the range the nearest bucket on the near side is an edge
+    // one, or its neighbour when that is empty. Cleared functions have no
+    // index and no buckets either.
+    const qint32 resolution = pItem.resolution;
+    qint32 beforeIndex = -1;
+    qint32 afterIndex = resolution;
+    if (next.count() == resolution)
+    {
+        if (index < 0)
+            afterIndex = (isOccupied(function, 0)? 0 : next.at(0));
+        else if (index >= resolution)
+            beforeIndex = (isOccupied(function, resolution-1)? resolution-1 : previous.at(resolution-1));
+        else
+        {
+            beforeIndex = previous.at(index);
+            afterIndex = next.at(index);
+        }
+    }
+
+    qreal before = (beforeIndex == -1? pItem.minimum / count() : function[beforeIndex]);
+    qreal after = (afterIndex == pItem.resolution? pItem.minimum / count() : function[afterIndex]);
+
+    qreal difVal = qAbs(after - before);
+    qreal difIdx = (afterIndex - beforeIndex);
+    qreal ratio = difVal / difIdx;
+    qreal res = qMin(before, after) + (afterIndex - index) * ratio;
+
+    return res;
+}
+
+qreal DataFetcher::Private::PropertyLabel::calculateRate_2(const PropertyItem &pItem, qreal value) const
+{
+    qint32 index = pItem.index(value);
+    if (index >= 0 && index <= pItem.resolution)
+        return pItem.scores.row(index)[labelIndex];
+
+    const qreal *function = this->function(pItem);
+
+    qreal res = 0;
+    for (qint32 i=0; i<pItem.resolution; i++)
+    {
+        qreal rate = function[i];
+        res += rate / qPow(qAbs(i - index) + 1, 4);
+    }
+
+    return res;
+}
@@ -0,0 +1,234 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DATAFETCHER_H
+#define DATAFETCHER_H
+
+#include <QObject>
+#include <QVariant>
+#include <QAbstractListModel>
+#include <QVector>
+
+#include <functional>
+
+class DataFetcher : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(QAbstractListModel* propertyModel READ propertyModel CONSTANT)
+    Q_PROPERTY(QVariantList labels READ labels NOTIFY sourceChanged)
+    Q_PROPERTY(QVariantMap checkedMap READ checkedMap NOTIFY checkedMapChanged)
+    Q_PROPERTY(QStringList properties READ properties WRITE setProperties NOTIFY propertiesChanged)
+    Q_PROPERTY(QVariantList mergables READ mergables WRITE setMergables NOTIFY mergablesChanged)
+    Q_PROPERTY(qint32 threads READ threads WRITE setThreads NOTIFY threadsChanged)
+    Q_PROPERTY(bool asynchronous READ asynchronous WRITE setAsynchronous NOTIFY asynchronousChanged)
+    Q_PROPERTY(bool streaming READ streaming WRITE setStreaming NOTIFY streamingChanged)
+    Q_PROPERTY(qint32 resolution READ resolution WRITE setResolution NOTIFY resolutionChanged)
+    Q_PROPERTY(bool compact READ compact WRITE setCompact NOTIFY compactChanged)
+    Q_PROPERTY(qint32 memoryBudget READ memoryBudget WRITE setMemoryBudget NOTIFY memoryBudgetChanged)
+    Q_PROPERTY(bool singlePass READ singlePass WRITE setSinglePass NOTIFY singlePassChanged)
+    Q_PROPERTY(Scorer scorer READ scorer WRITE setScorer NOTIFY scorerChanged)
+    Q_PROPERTY(qint32 cacheSize READ cacheSize WRITE setCacheSize NOTIFY cacheSizeChanged)
+    Q_PROPERTY(QString cacheDirectory READ cacheDirectory WRITE setCacheDirectory NOTIFY cacheDirectoryChanged)
+    Q_PROPERTY(bool incremental READ incremental WRITE setIncremental NOTIFY incrementalChanged)
+    Q_PROPERTY(bool watch READ watch WRITE setWatch NOTIFY watchChanged)
+    Q_PROPERTY(bool training READ training NOTIFY trainingChanged)
+    Q_PROPERTY(QString trace READ trace WRITE setTrace NOTIFY traceChanged)
+    Q_PROPERTY(QVariantMap stats READ stats NOTIFY sourceChanged)
+    class Private;
+    friend class PropertyModel;
+    friend class PropertyValueModel;
+    friend class DataFetcherTest;
+
+public:
+    enum Scorer {
+        SmoothScorer, // Every bucket blended into its neighbours, calculateRate_2
+        LinearScorer // Interpolated between the nearest non-empty buckets, calculateRate_1
+    };
+    Q_ENUM(Scorer)
+
+    typedef std::function<void(const QVariantMap &record)> RecordCallback;
+    typedef std::function<QVariantMap(const QVariantMap &request)> Classifier;
+
+    DataFetcher(QObject *parent = Q_NULLPTR);
+    virtual ~DataFetcher();
+
+    QString source() const;
+    void setSource(const QString &source);
+
+    bool asynchronous() const;
+    void setAsynchronous(bool asynchronous);
+
+    bool streaming() const;
+    void setStreaming(bool streaming);
+
+    // Buckets per property and label. 0 picks them per property from the
+    // sample count and spread of its values.
+    qint32 resolution() const;
+    void setResolution(qint32 resolution);
+
+    // Keeps the training values as float32. A memoryBudget in MB turns it
+    // on by itself when the values wouldn't fit as doubles, in full,
+    // incremental and cross-validation runs alike, 0 means no limit. Single
+    // pass models keep no values and ignore it.
+    bool compact() const;
+    void setCompact(bool compact);
+
+    qint32 memoryBudget() const;
+    void setMemoryBudget(qint32 memoryBudget);
+
+    // Bins the values as the files are read, into histograms that grow
+    // with the range, and never keeps them. Memory no longer grows with
+    // the corpus, but the buckets are approximate, the model can't be
+    // updated incrementally or saved as a partial snapshot, and the
+    // property model has no values to list.
+    bool singlePass() const;
+    void setSinglePass(bool singlePass);
+
+    // How a value is scored against the buckets of each label. Both work
+    // on the same model, so switching needs no retraining.
+    Scorer scorer() const;
+    void setScorer(Scorer scorer);
+
+    // check() results are cached by file path, size and modification time,
+    // model and settings: up to cacheSize in memory (256 by default, 0 is
+    // off), and below cacheDirectory on disk when it is set. Entries read
+    // back from disk are checked against the file content before use.
+    qint32 cacheSize() const;
+    void setCacheSize(qint32 cacheSize);
+
+    QString cacheDirectory() const;
+    void setCacheDirectory(const QString &cacheDirectory);
+
+    bool incremental() const;
+    void setIncremental(bool incremental);
+
+    bool watch() const;
+    void setWatch(bool watch);
+
+    bool training() const;
+
+    QString trace() const;
+    void setTrace(const QString &trace);
+
+    QVariantMap stats() const;
+
+    QStringList properties() const;
+    void setProperties(const QStringList &properties);
+
+    QVariantList mergables() const;
+    void setMergables(const QVariantList &mergables);
+
+    qint32 threads() const;
+    void setThreads(qint32 threads);
+
+    QAbstractListModel *propertyModel() const;
+    QVariantList labels();
+
+    QVariantMap checkedMap() const;
+
+    /*!
+     * Bulk access for C++ renderers. Appends every training value of
+     * \a property with its label index, and returns false if the property
+     * is unknown or has no range.
+     */
+    bool propertyValues(const QString &property, QVector<qint32> *labels, QVector<qreal> *values,
+                        qreal *minimum, qreal *maximum) const;
+    QVector<quint32> labelColors() const; // 0xAARRGGBB, by label index
+
+    /*!
+     * Classifies every file of \a paths (directories are expanded to their
+     * *.json files) in parallel against the current model, and blocks until
+     * all of them are done. Records reach \a callback one at a time, in no
+     * particular order and from worker threads. A non-empty \a output is
+     * written as CSV when it ends with ".csv", as JSON lines otherwise.
+     * Returns the number of records, or -1 if \a output can't be written.
+     */
+    qint32 classify(const QStringList &paths, const RecordCallback &callback = RecordCallback(), const QString &output = QString());
+
+    /*!
+     * Cross-validates the classifier on the labeled files of \a directory,
+     * or of source when it is empty, with the current settings, and blocks
+     * until it is done. The files are split into \a folds groups, 0 holds
+     * out every file on its own. Each fold subtracts its files from one
+     * model trained on all of them and classifies them against what is
+     * left, folds run in parallel. A prediction is the winning label, the
+     * best label of a merged winner, so mergables don't change what counts
+     * as correct. Returns the accuracy, precision and recall per label and
+     * the confusion matrix as {actual: {predicted: count}}.
+     */
+    QVariantMap evaluate(qint32 folds = 0, const QString &directory = QString());
+
+    /*!
+     * Captures the current model and settings. The returned function may
+     * be called from any thread and keeps scoring against that model after
+     * the fetcher retrains or loads another one. A request holds either the
+     * "path" of a chat file or its "months" as {month: {property: value}},
+     * the result is what check() returns.
+     */
+    Classifier classifier() const;
+
+    /*!
+     * Replaces the model with the union of the snapshots at \a paths,
+     * usually partial ones trained on separate shards. Their values are
+     * added up and binned once with the current settings, which gives the
+     * model of training on all the shards' files without reading them
+     * again. The result can't be updated incrementally.
+     */
+    bool mergeModels(const QStringList &paths);
+
+public Q_SLOTS:
+    QVariantMap check(const QString &path); // Holds an "error" when the file is unreadable or shares no property with the model
+    void classifyBatch(const QVariant &paths, const QString &output = QString());
+    bool saveModel(const QString &path, bool partial = false); // Partial leaves binning to mergeModels()
+    bool loadModel(const QString &path);
+    void cancel();
+    void refresh();
+
+Q_SIGNALS:
+    void sourceChanged();
+    void mergablesChanged();
+    void propertiesChanged();
+    void checkedMapChanged();
+    void threadsChanged();
+    void asynchronousChanged();
+    void streamingChanged();
+    void resolutionChanged();
+    void compactChanged();
+    void memoryBudgetChanged();
+    void singlePassChanged();
+    void scorerChanged();
+    void cacheSizeChanged();
+    void cacheDirectoryChanged();
+    void incrementalChanged();
+    void watchChanged();
+    void trainingChanged();
+    void traceChanged();
+    void filesParsed(qint32 count, qint32 total);
+    void propertiesBinned(qint32 count, qint32 total);
+    void classified(const QVariantMap &record);
+    void batchFinished(qint32 count, const QString &output);
+
+private:
+    void startTraining();
+
+private:
+    Private *p;
+};
+
+#endif // DATAFETCHER_H
@@ -0,0 +1,516 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DATAFETCHER_P_H
+#define DATAFETCHER_P_H
+
+// Not part of the public API. Shared by the core classes that read the
+// trained model directly.
+
+#define RESOLUTION 1000
+#define MINIMUM_RESOLUTION 16
+#define MAXIMUM_RESOLUTION 4096
+
+#include "datafetcher.h"
+#include "arena.h"
+#include "histogramtable.h"
+#include "resultcache.h"
+#include "streaminghistogram.h"
+#include "stringpool.h"
+#include "tracer.h"
+
+#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QList>
+#include <QVector>
+#include <QStringList>
+#include <QFile>
+#include <QThreadPool>
+#include <QFuture>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+#include <cstring>
+
+class QFileSystemWatcher;
+class QTimer;
+class PropertyModel;
+
+class DataFetcher::Private
+{
+public:
+    class DataItem;
+    class PropertyItem;
+    class PropertyLabel;
+    class ValueColumn;
+    class FileData;
+    class Model;
+    class TrainJob;
+    class TrainStats;
+    class Changes;
+    class ClassifyJob;
+    class SnapshotHeader;
+    class SnapshotLabel;
+    class SnapshotProperty;
+    class SnapshotEntry;
+    class SnapshotBin;
+
+    typedef QMap<QString, qreal> SumMap;
+    typedef QMap<QString, SumMap> MonthMap;
+
+    static bool readMonths(const QString &path, bool streaming, QString *label, MonthMap *months,
+                           qint64 *readTime = Q_NULLPTR, qint64 *bytesRead = Q_NULLPTR, QByteArray *hash = Q_NULLPTR);
+    static QByteArray hashFile(const QString &path);
+    static FileData readFile(const QString &path, bool streaming, bool hash, TrainStats *stats = Q_NULLPTR, Tracer *tracer = Q_NULLPTR);
+    static QVector<FileData> readFiles(TrainJob *job, const QStringList &paths, qint32 done = 0, qint32 total = 0);
+
+    static void train(TrainJob *job);
+    static bool load(TrainJob *job);
+    static bool calculateProperties(TrainJob *job);
+    static bool accumulate(TrainJob *job);
+    static bool calculateFunctions(TrainJob *job);
+    static bool update(TrainJob *job);
+    static void addFile(Model *model, FileData &data, Changes *changes);
+    static void removeFile(Model *model, const FileData &data, Changes *changes);
+    static void rescanRanges(Model *model, const Changes &changes);
+    static bool rebin(Model *model, const Changes &changes, qint32 resolution, TrainJob *job = Q_NULLPTR);
+
+    static void merge(Model *model, FileData &data);
+    static void merge(Model *model, const Model &partial);
+    static void addValue(Model *model, qint32 label, qint32 property, qreal value);
+    static void addSample(Model *model, qint32 label, qint32 property, qreal value);
+    static void pack(Model *model, Changes *changes);
+    static qint64 valueBytes(const Model *model);
+    static QByteArray trainedVersion(const Model *model);
+    static bool removeValue(Model *model, qint32 label, qint32 property, qreal value);
+    static void calculateFunction(PropertyItem &pItem, const PropertyLabel &pLabel);
+    static void indexNeighbours(PropertyLabel &pLabel, const qreal *function, qint32 resolution);
+    static void clearFunction(PropertyItem &pItem, qint32 label);
+    static void calculateScores(PropertyItem &pItem, const PropertyLabel &pLabel);
+    template<qint32 N>
+    static void smoothFunction(const qreal *function, qreal *score, qint32 stride, qint32 resolution);
+    static const qreal *smoothingWeights();
+    static qint32 chooseResolution(const PropertyItem &pItem, qint32 resolution);
+
+    static QVariantMap classify(const ClassifyJob &job, const MonthMap &months, QVariantMap *checkedMap);
+    static QVariantMap evaluate(TrainJob *job, qint32 folds, const QStringList &properties, const QVariantList &mergables, Scorer scorer);
+    static qint32 classifyFiles(ClassifyJob *job, const QStringList &paths, const RecordCallback &callback, const QString &output);
+    static QStringList expandPaths(const QStringList &paths);
+    static QStringList listSource(const QString &source);
+    static QString exportLabel(const QString &path);
+    static QString csvField(const QString &text);
+    static QString colorName(quint32 color) { return QString("#%1").arg(color, 8, 16, QChar('0')); }
+
+    static bool saveModel(const Model &model, const QString &path, bool partial = false);
+    static bool loadModel(const QString &path, Model *model, bool *partial = Q_NULLPTR, bool merging = false);
+
+    static QByteArray cacheKey(const ClassifyJob &job, const QString &path);
+
+    QSharedPointer<ClassifyJob> classifyJob();
+    void setModel(const QSharedPointer<Model> &newModel);
+    void retire(const QFuture<void> &future);
+
+    QString source;
+    qint32 threads = 0;
+    qint32 resolution = RESOLUTION;
+    bool asynchronous = false;
+    bool streaming = true;
+    bool incremental = false;
+    bool watch = false;
+    bool compact = false;
+    bool singlePass = false;
+    qint32 memoryBudget = 0;
+    Scorer scorer = SmoothScorer;
+    QString trace;
+    QThreadPool pool;
+    QFileSystemWatcher *watcher = Q_NULLPTR;
+    QTimer *refreshTimer;
+    PropertyModel *propertyModel;
+
+    QVariantMap checkedMap;
+    QVariantList mergables;
+    QStringList propertiesValue;
+    QSharedPointer<Model> model;
+    QSharedPointer<TrainJob> job;
+    QSharedPointer<ClassifyJob> batch;
+    QList<QFuture<void> > retired; // Canceled jobs that may still run
+    ResultCache cache;
+};
+
+class DataFetcher::Private::DataItem
+{
+public:
+    quint32 color = 0; // 0xAARRGGBB, so the core doesn't need QtGui
+    qint32 index = 0;
+    QString label;
+};
+
+/*
+ * The training values of one property under one label. Compact columns
+ * keep them as float32, which halves the memory and is still far finer
+ * than any bucket. A column either owns an implicitly shared buffer or
+ * fills a fixed span of the model's arena or of a mapped snapshot. Fixed
+ * spans are never written once squeezed, any later change first moves the
+ * values to a buffer.
+ */
+class DataFetcher::Private::ValueColumn
+{
+public:
+    bool isCompact() const { return compact; }
+    void setCompact(bool compact);
+
+    qint32 count() const { return size; }
+    bool isEmpty() const { return size == 0; }
+    qreal at(qint32 i) const { return compact? static_cast<const float*>(values)[i] : static_cast<const qreal*>(values)[i]; }
+    qreal stored(qreal value) const { return compact? static_cast<float>(value) : value; }
+    qint64 bytes() const { return static_cast<qint64>(capacity) * width(); }
+
+    void append(qreal value);
+    bool removeOne(qreal value);
+    void reserve(qint32 size) { if (size > capacity) reallocate(size, compact); }
+    void squeeze();
+    void allocate(Arena *arena, qint32 capacity); // Only on an empty column
+    void borrow(const qreal *values, qint32 count); // Read only doubles, only on an empty column
+
+private:
+    qint32 width() const { return compact? sizeof(float) : sizeof(qreal); }
+    void reallocate(qint32 capacity, bool compact);
+
+    QVector<float> floats;
+    QVector<qreal> doubles;
+    void *values = Q_NULLPTR; // Into floats, doubles or the arena
+    qint32 size = 0;
+    qint32 capacity = 0;
+    bool compact = false;
+    bool fixed = false;
+};
+
+inline void DataFetcher::Private::ValueColumn::reallocate(qint32 capacity, bool compact)
+{
+    QVector<float> newFloats(compact? capacity : 0);
+    QVector<qreal> newDoubles(compact? 0 : capacity);
+    for (qint32 i=0; i<size; i++)
+    {
+        if (compact)
+            newFloats[i] = at(i);
+        else
+            newDoubles[i] = at(i);
+    }
+
+    floats = newFloats;
+    doubles = newDoubles;
+    values = compact? static_cast<void*>(floats.data()) : static_cast<void*>(doubles.data());
+    this->capacity = capacity;
+    this->compact = compact;
+    fixed = false;
+}
+
+inline void DataFetcher::Private::ValueColumn::setCompact(bool compact)
+{
+    if (this->compact != compact)
+        reallocate(capacity, compact);
+}
+
+inline void DataFetcher::Private::ValueColumn::append(qreal value)
+{
+    if (size == capacity)
+        reallocate(qMax(capacity * 2, 4), compact);
+    else if (!fixed) // Detaches a buffer shared with a copy of the model
+        values = compact? static_cast<void*>(floats.data()) : static_cast<void*>(doubles.data());
+
+    if (compact)
+        static_cast<float*>(values)[size++] = static_cast<float>(value);
+    else
+        static_cast<qreal*>(values)[size++] = value;
+}
+
+inline bool DataFetcher::Private::ValueColumn::removeOne(qreal value)
+{
+    value = stored(value);
+    qint32 index = 0;
+    while (index < size && at(index) != value)
+        index++;
+    if (index == size)
+        return false;
+
+    if (fixed)
+        reallocate(capacity, compact);
+    else
+        values = compact? static_cast<void*>(floats.data()) : static_cast<void*>(doubles.data());
+
+    char *data = static_cast<char*>(values);
+    memmove(data + index * width(), data + (index + 1) * width(), (size - index - 1) * width());
+    size--;
+    return true;
+}
+
+inline void DataFetcher::Private::ValueColumn::squeeze()
+{
+    if (fixed)
+        capacity = size;
+    else if (size < capacity)
+        reallocate(size, compact);
+}
+
+inline void DataFetcher::Private::ValueColumn::allocate(Arena *arena, qint32 capacity)
+{
+    Q_ASSERT(isEmpty());
+    floats = QVector<float>();
+    doubles = QVector<qreal>();
+    values = compact? static_cast<void*>(arena->allocate<float>(capacity)) : static_cast<void*>(arena->allocate<qreal>(capacity));
+    this->capacity = capacity;
+    fixed = true;
+}
+
+inline void DataFetcher::Private::ValueColumn::borrow(const qreal *values, qint32 count)
+{
+    Q_ASSERT(isEmpty());
+    floats = QVector<float>();
+    doubles = QVector<qreal>();
+    this->values = const_cast<qreal*>(values);
+    size = count;
+    capacity = count;
+    compact = false;
+    fixed = true;
+}
+
+class DataFetcher::Private::PropertyLabel
+{
+public:
+    ValueColumn values;
+    qint32 samples = 0; // Values seen, when the values themselves aren't kept
+    qint32 labelIndex = -1;
+
+    // Nearest non-empty bucket of the function before and after each one,
+    // -1 and resolution when there is none. Built with the function, so
+    // calculateRate_1 interpolates without scanning it.
+    QVector<qint16> previous;
+    QVector<qint16> next;
+
+    // Values at the minimum weigh 0, so bucket 0 can hold some and still
+    // read 0. It counts as occupied anyway, as it did when the buckets were
+    // the keys of a map.
+    bool minimumOccupied = false;
+
+    bool isValid() const { return labelIndex >= 0; }
+    bool isOccupied(const qreal *function, qint32 index) const { return function[index] != 0 || (index == 0 && minimumOccupied); }
+    qint32 count() const { return values.isEmpty()? samples : values.count(); }
+
+    // Buckets live in row labelIndex of PropertyItem::functions. The smoothed
+    // curve used by calculateRate_2 is column labelIndex of scores, whose
+    // rows are indexed by bucket so one row scores every label at once.
+    const qreal *function(const PropertyItem &pItem) const;
+
+    qreal checkRate(const PropertyItem &pItem, qreal value, Scorer scorer) const;
+    qreal calculateRate_1(const PropertyItem &pItem, qreal value) const;
+    qreal calculateRate_2(const PropertyItem &pItem, qreal value) const;
+};
+
+class DataFetcher::Private::PropertyItem
+{
+public:
+    QVector<PropertyLabel> labels; // Indexed by label id, unused slots are invalid
+    HistogramTable functions;
+    HistogramTable scores;
+    StreamingHistogram histogram; // Stands in for the values of a single pass model while it trains
+
+    QString property;
+    qreal maximum = INT_MIN;
+    qreal minimum = INT_MAX;
+    qreal sum = 0;
+    qint32 count = 0;
+    qint32 resolution = RESOLUTION; // Buckets per label, scores has one row more
+
+    bool hasRange() const { return count && maximum != minimum; }
+    bool contains(qint32 label) const { return label < labels.count() && labels.at(label).isValid(); }
+    qint32 index(qreal value) const { return ( (value - minimum) / (maximum - minimum) ) * resolution; }
+};
+
+inline const qreal *DataFetcher::Private::PropertyLabel::function(const PropertyItem &pItem) const
+{
+    return pItem.functions.row(labelIndex);
+}
+
+/*
+ * One training file. The values of all its months sit in two parallel
+ * arrays, ids index properties until the file is merged and the model's
+ * interned properties after that.
+ */
+class DataFetcher::Private::FileData
+{
+public:
+    QStringList properties; // Dropped once merged
+    QVector<qint32> ids; // Kept for updatable models only, like values
+    QVector<qreal> values;
+    QString label;
+    qint32 labelIndex = -1;
+    bool valid = false;
+
+    qint64 size = 0;
+    qint64 modified = 0;
+    QByteArray hash;
+};
+
+/*
+ * The trained model. Labels and properties are interned once, everything
+ * below the API boundary is addressed by those ids: items and properties
+ * are indexed by them directly.
+ */
+class DataFetcher::Private::Model
+{
+public:
+    StringPool labelNames;
+    StringPool propertyNames;
+    QVector<DataItem> items;
+    QVector<PropertyItem> properties;
+    QHash<QString, FileData> files;
+    QSharedPointer<Arena> arena; // Value columns of a one pass model
+    QSharedPointer<QFile> snapshot; // Mapped, value columns of a loaded model point into it
+    QByteArray snapshotData; // Read instead where the snapshot can't be mapped
+    QVariantMap stats; // Timings and counters of the training run that built this model
+    QByteArray version; // Results are cached under it: hash of the trained files and settings, or the snapshot's hash
+    qint32 resolution = RESOLUTION; // As asked for, 0 is adaptive
+    bool compact = false; // Float32 value columns
+    bool singlePass = false; // Binned from histograms, no values kept
+    bool updatable = true; // False once the files' samples are gone, e.g. for a snapshot
+
+    qint32 internLabel(const QString &label) {
+        const qint32 id = labelNames.intern(label);
+        if (id == items.count())
+        {
+            DataItem item;
+            const quint32 red = qrand()%255;
+            const quint32 green = qrand()%255;
+            const quint32 blue = qrand()%255;
+            item.color = 0xff000000 | (red << 16) | (green << 8) | blue;
+            item.index = id;
+            item.label = label;
+            items << item;
+        }
+        return id;
+    }
+
+    qint32 internProperty(const QString &property) {
+        const qint32 id = propertyNames.intern(property);
+        if (id == properties.count())
+        {
+            PropertyItem pItem;
+            pItem.property = property;
+            properties << pItem;
+        }
+        return id;
+    }
+};
+
+/*
+ * What a batch of added and removed files touched, so only that is binned
+ * again: a few labels of a property, or all of them once its range moved.
+ */
+class DataFetcher::Private::Changes
+{
+public:
+    QHash<qint32, QPair<qreal, qreal> > ranges; // Of every touched property, as they were before
+    QHash<qint32, QSet<qint32> > dirtyLabels;
+    QSet<qint32> rescan; // Lost an edge value
+
+    void touch(const Model *model, qint32 property, qint32 label);
+};
+
+/*
+ * Collected by every training run. Phases are wall time in nanoseconds,
+ * except reading and parsing, which add up the time of all workers.
+ */
+class DataFetcher::Private::TrainStats
+{
+public:
+    QAtomicInteger<qint64> total;
+    QAtomicInteger<qint64> listing;
+    QAtomicInteger<qint64> reading;
+    QAtomicInteger<qint64> parsing;
+    QAtomicInteger<qint64> statistics;
+    QAtomicInteger<qint64> binning;
+
+    QAtomicInteger<qint64> bytesRead;
+    QAtomicInteger<qint64> files;
+    QAtomicInteger<qint64> filesSkipped;
+    QAtomicInteger<qint64> filesFailed;
+    QAtomicInteger<qint64> overBudget; // Peak bytes of training values past the memory budget, even packed
+
+    void exceedBudget(qint64 bytes) {
+        qint64 peak = overBudget.load();
+        while (bytes > peak && !overBudget.testAndSetRelaxed(peak, bytes))
+            peak = overBudget.load();
+    }
+
+    QVariantMap toMap() const {
+        auto ms = [](const QAtomicInteger<qint64> &nsecs) { return nsecs.load() / 1e6; };
+        return {
+            {"totalTime", ms(total)}, {"listingTime", ms(listing)}, {"readingTime", ms(reading)},
+            {"parsingTime", ms(parsing)}, {"statisticsTime", ms(statistics)}, {"binningTime", ms(binning)},
+            {"bytesRead", bytesRead.load()}, {"files", files.load()},
+            {"filesSkipped", filesSkipped.load()}, {"filesFailed", filesFailed.load()},
+            {"overBudget", overBudget.load()}
+        };
+    }
+};
+
+class DataFetcher::Private::TrainJob
+{
+public:
+    DataFetcher *fetcher = Q_NULLPTR;
+    QThreadPool *pool = Q_NULLPTR;
+    QString source;
+    bool streaming = true;
+    bool incremental = false;
+    bool singlePass = false;
+    qint32 resolution = RESOLUTION;
+    qint64 memoryBudget = 0; // Bytes of training values, 0 is unlimited
+    QSharedPointer<Model> model;
+    QVector<FileData> pending; // Read by load, consumed by calculateProperties
+    TrainStats stats;
+    QSharedPointer<Tracer> tracer; // Only set when a trace file was asked for
+    QString tracePath;
+    QAtomicInt canceled;
+    QFuture<void> future;
+
+    bool isCanceled() const { return canceled.loadAcquire(); }
+};
+
+/*
+ * Everything a classification reads, captured once so a batch keeps
+ * scoring against the same model and settings while the fetcher retrains.
+ */
+class DataFetcher::Private::ClassifyJob
+{
+public:
+    QThreadPool *pool = Q_NULLPTR;
+    bool streaming = true;
+    Scorer scorer = SmoothScorer;
+    QStringList properties;
+    QVariantList mergables;
+    QSharedPointer<Model> model;
+    QAtomicInt canceled;
+    QFuture<qint32> future;
+
+    bool isCanceled() const { return canceled.loadAcquire(); }
+};
+
+#endif // DATAFETCHER_P_H
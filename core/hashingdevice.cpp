@@ -0,0 +1,49 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "hashingdevice.h"
+
+HashingDevice::HashingDevice(QIODevice *source, QCryptographicHash::Algorithm algorithm) :
+    source(source),
+    hash(algorithm)
+{
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+QByteArray HashingDevice::result()
+{
+    hash.addData(source);
+    return hash.result();
+}
+
+qint64 HashingDevice::readData(char *data, qint64 maxSize)
+{
+    const qint64 length = source->read(data, maxSize);
+    if (length > 0)
+        hash.addData(data, static_cast<int>(length));
+    return length;
+}
+
+qint64 HashingDevice::writeData(const char *, qint64)
+{
+    return -1;
+}
+
+HashingDevice::~HashingDevice()
+{
+}
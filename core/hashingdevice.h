@@ -0,0 +1,51 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HASHINGDEVICE_H
+#define HASHINGDEVICE_H
+
+#include <QIODevice>
+#include <QCryptographicHash>
+
+/*!
+ * Read only pass-through over \a source that hashes every byte as it is
+ * read, so a file is parsed and hashed in the same pass. The device is
+ * unbuffered, so what was hashed is exactly what the reader consumed.
+ * result() first hashes whatever the reader left unread.
+ */
+class HashingDevice : public QIODevice
+{
+public:
+    HashingDevice(QIODevice *source, QCryptographicHash::Algorithm algorithm = QCryptographicHash::Sha1);
+    virtual ~HashingDevice();
+
+    bool isSequential() const Q_DECL_OVERRIDE { return true; }
+    bool atEnd() const Q_DECL_OVERRIDE { return source->atEnd(); }
+    qint64 bytesAvailable() const Q_DECL_OVERRIDE { return source->bytesAvailable(); }
+    QByteArray result();
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+    qint64 writeData(const char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+
+private:
+    QIODevice *source;
+    QCryptographicHash hash;
+};
+
+#endif // HASHINGDEVICE_H
@@ -0,0 +1,168 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define CACHE_LINE_SIZE 64
+
+#include "histogramtable.h"
+
+#include <QSharedData>
+
+#include <cstring>
+
+class HistogramTableData : public QSharedData
+{
+public:
+    HistogramTableData() {}
+    HistogramTableData(const HistogramTableData &other) :
+        QSharedData(other),
+        rows(other.rows),
+        columns(other.columns),
+        stride(other.stride)
+    {
+        allocate();
+        if (data)
+            memcpy(data, other.data, bytes());
+    }
+    ~HistogramTableData() {
+        qFreeAligned(data);
+    }
+
+    size_t bytes() const { return static_cast<size_t>(rows) * stride * sizeof(qreal); }
+
+    void allocate() {
+        data = Q_NULLPTR;
+        if (rows * stride == 0)
+            return;
+
+        data = static_cast<qreal*>(qMallocAligned(bytes(), CACHE_LINE_SIZE));
+        Q_CHECK_PTR(data);
+    }
+
+    qint32 rows = 0;
+    qint32 columns = 0;
+    qint32 stride = 0;
+    qreal *data = Q_NULLPTR;
+};
+
+HistogramTable::HistogramTable() :
+    d(new HistogramTableData)
+{
+}
+
+HistogramTable::HistogramTable(const HistogramTable &other) :
+    d(other.d)
+{
+}
+
+HistogramTable &HistogramTable::operator=(const HistogramTable &other)
+{
+    d = other.d;
+    return *this;
+}
+
+void HistogramTable::resize(qint32 rows, qint32 columns)
+{
+    const qint32 perLine = CACHE_LINE_SIZE / sizeof(qreal);
+
+    HistogramTableData *data = new HistogramTableData;
+    data->rows = rows;
+    data->columns = columns;
+    data->stride = (columns + perLine - 1) / perLine * perLine;
+    data->allocate();
+    if (data->data)
+        memset(data->data, 0, data->bytes());
+
+    d = data;
+}
+
+void HistogramTable::reserveRows(qint32 rows)
+{
+    const HistogramTableData *old = d.constData();
+    if (rows <= old->rows)
+        return;
+
+    HistogramTable res;
+    res.resize(rows, old->columns);
+    if (old->data)
+        memcpy(res.d->data, old->data, old->bytes());
+
+    d = res.d;
+}
+
+void HistogramTable::reserveColumns(qint32 columns)
+{
+    const HistogramTableData *old = d.constData();
+    if (columns <= old->columns)
+        return;
+
+    HistogramTable res;
+    res.resize(old->rows, columns);
+    for (qint32 r=0; r<old->rows; r++)
+        memcpy(res.d->data + static_cast<qint64>(r) * res.d->stride, old->data + static_cast<qint64>(r) * old->stride, old->columns * sizeof(qreal));
+
+    d = res.d;
+}
+
+void HistogramTable::clearRow(qint32 row)
+{
+    memset(this->row(row), 0, d->stride * sizeof(qreal));
+}
+
+void HistogramTable::clear()
+{
+    d = new HistogramTableData;
+}
+
+qint32 HistogramTable::rows() const
+{
+    return d->rows;
+}
+
+qint32 HistogramTable::columns() const
+{
+    return d->columns;
+}
+
+qint32 HistogramTable::stride() const
+{
+    return d->stride;
+}
+
+bool HistogramTable::isEmpty() const
+{
+    return d->rows == 0;
+}
+
+const qreal *HistogramTable::row(qint32 row) const
+{
+    return d->data + static_cast<qint64>(row) * d->stride;
+}
+
+qreal *HistogramTable::row(qint32 row)
+{
+    return d->data + static_cast<qint64>(row) * d->stride;
+}
+
+const qreal *HistogramTable::constData() const
+{
+    return d->data;
+}
+
+HistogramTable::~HistogramTable()
+{
+}
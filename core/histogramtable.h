@@ -0,0 +1,62 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HISTOGRAMTABLE_H
+#define HISTOGRAMTABLE_H
+
+#include <QtGlobal>
+#include <QSharedDataPointer>
+
+class HistogramTableData;
+
+/*!
+ * Dense rows x columns table of reals, one row per label. Rows are stored
+ * back to back and every row starts on a cache line, so a whole property
+ * can be walked through one contiguous block. The table is implicitly
+ * shared and only copied when a shared instance is written.
+ */
+class HistogramTable
+{
+public:
+    HistogramTable();
+    HistogramTable(const HistogramTable &other);
+    virtual ~HistogramTable();
+
+    HistogramTable &operator=(const HistogramTable &other);
+
+    void resize(qint32 rows, qint32 columns);
+    void reserveRows(qint32 rows);
+    void reserveColumns(qint32 columns);
+    void clearRow(qint32 row);
+    void clear();
+
+    qint32 rows() const;
+    qint32 columns() const;
+    qint32 stride() const;
+    bool isEmpty() const;
+
+    const qreal *row(qint32 row) const;
+    qreal *row(qint32 row);
+
+    const qreal *constData() const;
+
+private:
+    QSharedDataPointer<HistogramTableData> d;
+};
+
+#endif // HISTOGRAMTABLE_H
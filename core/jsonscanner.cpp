@@ -0,0 +1,256 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define MAXIMUM_DEPTH 1024
+
+#include "jsonscanner.h"
+
+bool JsonScanner::setError(const QString &message)
+{
+    if (error.isEmpty())
+        error = QString("%1 at offset %2").arg(message).arg(offset + pos);
+    return false;
+}
+
+bool JsonScanner::expect(char c)
+{
+    if (token() != c)
+        return setError(QString("'%1' expected").arg(c));
+
+    pos++;
+    return true;
+}
+
+bool JsonScanner::parseString(QByteArray *out)
+{
+    if (out)
+        out->resize(0);
+    if (get() != '"')
+        return setError("string expected");
+
+    while (true)
+    {
+        int c = get();
+        switch (c)
+        {
+        case -1:
+            return setError("unterminated string");
+        case '"':
+            return true;
+        case '\\':
+            break;
+        default:
+            if (out)
+                out->append(static_cast<char>(c));
+            continue;
+        }
+
+        c = get();
+        char escaped = 0;
+        switch (c)
+        {
+        case '"':  escaped = '"';  break;
+        case '\\': escaped = '\\'; break;
+        case '/':  escaped = '/';  break;
+        case 'b':  escaped = '\b'; break;
+        case 'f':  escaped = '\f'; break;
+        case 'n':  escaped = '\n'; break;
+        case 'r':  escaped = '\r'; break;
+        case 't':  escaped = '\t'; break;
+        case 'u':
+            break;
+        default:
+            return setError("invalid escape sequence");
+        }
+
+        if (escaped)
+        {
+            if (out)
+                out->append(escaped);
+            continue;
+        }
+
+        uint code = 0;
+        for (qint32 i=0; i<4; i++)
+        {
+            int h = get();
+            code <<= 4;
+            if (h >= '0' && h <= '9') code |= (h - '0');
+            else if (h >= 'a' && h <= 'f') code |= (h - 'a' + 10);
+            else if (h >= 'A' && h <= 'F') code |= (h - 'A' + 10);
+            else return setError("invalid unicode escape");
+        }
+
+        if (!out)
+            continue;
+
+        ushort utf16[2] = { static_cast<ushort>(code), 0 };
+        qint32 utf16Len = 1;
+        if (QChar::isHighSurrogate(code) && peek() == '\\')
+        {
+            // The low half of a surrogate pair is a second \uXXXX escape.
+            pos++;
+            if (get() != 'u')
+                return setError("invalid surrogate pair");
+
+            uint low = 0;
+            for (qint32 i=0; i<4; i++)
+            {
+                int h = get();
+                low <<= 4;
+                if (h >= '0' && h <= '9') low |= (h - '0');
+                else if (h >= 'a' && h <= 'f') low |= (h - 'a' + 10);
+                else if (h >= 'A' && h <= 'F') low |= (h - 'A' + 10);
+                else return setError("invalid unicode escape");
+            }
+            utf16[1] = static_cast<ushort>(low);
+            utf16Len = 2;
+        }
+
+        out->append(QString::fromUtf16(utf16, utf16Len).toUtf8());
+    }
+}
+
+bool JsonScanner::parseNumber(qreal *out)
+{
+    number.resize(0);
+    while (true)
+    {
+        int c = peek();
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')
+        {
+            number.append(static_cast<char>(c));
+            pos++;
+        }
+        else
+            break;
+    }
+
+    bool ok = false;
+    qreal value = number.toDouble(&ok);
+    if (!ok)
+        return setError("invalid number");
+    if (out)
+        *out = value;
+    return true;
+}
+
+bool JsonScanner::parseLiteral(const char *word)
+{
+    for (const char *c = word; *c; c++)
+        if (get() != *c)
+            return setError(QString("'%1' expected").arg(word));
+    return true;
+}
+
+bool JsonScanner::parseObject(const MemberCallback &member)
+{
+    if (!expect('{'))
+        return false;
+    if (++depth > MAXIMUM_DEPTH)
+        return setError("document too deep");
+
+    if (token() == '}')
+    {
+        pos++;
+        depth--;
+        return true;
+    }
+
+    while (true)
+    {
+        if (token() != '"')
+            return setError("object key expected");
+        if (!parseString(&key))
+            return false;
+        if (!expect(':'))
+            return false;
+        if (!member(key))
+            return false;
+
+        int c = token();
+        pos++;
+        if (c == ',')
+            continue;
+        if (c == '}')
+            break;
+
+        return setError("',' or '}' expected");
+    }
+
+    depth--;
+    return true;
+}
+
+bool JsonScanner::parseArray(const ElementCallback &element)
+{
+    if (!expect('['))
+        return false;
+    if (++depth > MAXIMUM_DEPTH)
+        return setError("document too deep");
+
+    if (token() == ']')
+    {
+        pos++;
+        depth--;
+        return true;
+    }
+
+    while (true)
+    {
+        if (!element())
+            return false;
+
+        int c = token();
+        pos++;
+        if (c == ',')
+            continue;
+        if (c == ']')
+            break;
+
+        return setError("',' or ']' expected");
+    }
+
+    depth--;
+    return true;
+}
+
+bool JsonScanner::skipValue()
+{
+    switch (token())
+    {
+    case '{':
+        return parseObject([this](const QByteArray &){ return skipValue(); });
+
+    case '[':
+        return parseArray([this](){ return skipValue(); });
+
+    case '"':
+        return parseString(Q_NULLPTR);
+    case 't':
+        return parseLiteral("true");
+    case 'f':
+        return parseLiteral("false");
+    case 'n':
+        return parseLiteral("null");
+    case -1:
+        return setError("unexpected end of data");
+    default:
+        return parseNumber(Q_NULLPTR);
+    }
+}
@@ -0,0 +1,100 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef JSONSCANNER_H
+#define JSONSCANNER_H
+
+#define JSON_SCANNER_CHUNK_SIZE 65536
+
+#include <QString>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QIODevice>
+
+#include <functional>
+
+/*!
+ * Pull tokenizer over a QIODevice, which is read in fixed size chunks, so
+ * a document of any size is walked once in constant memory. The readers
+ * decode the parts they need on top of it and skip everything else.
+ */
+class JsonScanner
+{
+public:
+    typedef std::function<bool(const QByteArray &key)> MemberCallback;
+    typedef std::function<bool()> ElementCallback;
+
+    JsonScanner(QIODevice *device) : device(device) {}
+
+    inline int peek() {
+        if (pos == length)
+        {
+            offset += length;
+            pos = 0;
+            QElapsedTimer timer;
+            timer.start();
+            length = qMax<qint64>(device->read(buffer, JSON_SCANNER_CHUNK_SIZE), 0);
+            readNsecs += timer.nsecsElapsed();
+            if (length == 0)
+                return -1;
+        }
+        return static_cast<uchar>(buffer[pos]);
+    }
+    inline int get() {
+        int c = peek();
+        if (c != -1) pos++;
+        return c;
+    }
+    inline int token() {
+        int c = peek();
+        while (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+        {
+            pos++;
+            c = peek();
+        }
+        return c;
+    }
+
+    bool setError(const QString &message);
+    bool expect(char c);
+    bool parseString(QByteArray *out);
+    bool parseNumber(qreal *out);
+    bool parseLiteral(const char *word);
+    bool parseObject(const MemberCallback &member);
+    bool parseArray(const ElementCallback &element);
+    bool skipValue();
+
+    QString errorString() const { return error; }
+    qint64 bytesRead() const { return offset + length; }
+    qint64 readTime() const { return readNsecs; } // Nanoseconds spent waiting on the device
+
+private:
+    QIODevice *device;
+    char buffer[JSON_SCANNER_CHUNK_SIZE];
+    qint64 length = 0;
+    qint64 pos = 0;
+    qint64 offset = 0;
+    qint32 depth = 0;
+    qint64 readNsecs = 0;
+    QString error;
+
+    QByteArray key;
+    QByteArray number;
+};
+
+#endif // JSONSCANNER_H
@@ -0,0 +1,202 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "jsonstreamreader.h"
+#include "jsonscanner.h"
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QVector>
+
+class JsonStreamReader::Private
+{
+public:
+    class Tuple
+    {
+    public:
+        QString month;
+        QString property;
+        qreal value;
+    };
+
+    Private(QIODevice *device) : scanner(device) {}
+
+    JsonScanner scanner;
+
+    Callback callback;
+    QVector<Tuple> pending;
+    QString label;
+    bool labelFound = false;
+    bool hasRecord = false;
+
+    QByteArray text;
+
+    bool parseRecord();
+    bool parseMonth(const QString &month);
+    bool parseSum(const QString &month);
+    void emitValue(const QString &month, const QString &property, qreal value);
+};
+
+JsonStreamReader::JsonStreamReader(QIODevice *device)
+{
+    p = new Private(device);
+}
+
+bool JsonStreamReader::read(const Callback &callback)
+{
+    p->callback = callback;
+
+    if (!p->scanner.expect('['))
+        return false;
+
+    if (p->scanner.token() == ']')
+        return true;
+
+    bool ok = (p->scanner.token() == '{'? p->parseRecord() : p->scanner.skipValue());
+    if (!ok)
+        return false;
+
+    // Values seen before the label (or in a record without one) are kept
+    // until the end of the record, so the callback always gets the label.
+    p->labelFound = true;
+    for (const Private::Tuple &t: p->pending)
+        p->callback(p->label, t.month, t.property, t.value);
+    p->pending.clear();
+
+    return true;
+}
+
+bool JsonStreamReader::hasRecord() const
+{
+    return p->hasRecord;
+}
+
+QString JsonStreamReader::label() const
+{
+    return p->label;
+}
+
+QString JsonStreamReader::errorString() const
+{
+    return p->scanner.errorString();
+}
+
+qint64 JsonStreamReader::bytesRead() const
+{
+    return p->scanner.bytesRead();
+}
+
+qint64 JsonStreamReader::readTime() const
+{
+    return p->scanner.readTime();
+}
+
+JsonStreamReader::~JsonStreamReader()
+{
+    delete p;
+}
+
+
+bool JsonStreamReader::Private::parseRecord()
+{
+    hasRecord = true;
+    return scanner.parseObject([this](const QByteArray &name) -> bool {
+        if (name == "label" && scanner.token() == '"')
+        {
+            if (!scanner.parseString(&text))
+                return false;
+
+            label = QString::fromUtf8(text);
+            labelFound = true;
+            for (const Tuple &t: pending)
+                callback(label, t.month, t.property, t.value);
+            pending.clear();
+            return true;
+        }
+
+        if (name == "months" && scanner.token() == '{')
+            return scanner.parseObject([this](const QByteArray &month) -> bool {
+                if (scanner.token() != '{')
+                    return scanner.skipValue();
+                return parseMonth(QString::fromUtf8(month));
+            });
+
+        return scanner.skipValue();
+    });
+}
+
+bool JsonStreamReader::Private::parseMonth(const QString &month)
+{
+    return scanner.parseObject([this, &month](const QByteArray &name) -> bool {
+        if (name == "sum" && scanner.token() == '{')
+            return parseSum(month);
+        return scanner.skipValue();
+    });
+}
+
+bool JsonStreamReader::Private::parseSum(const QString &month)
+{
+    return scanner.parseObject([this, &month](const QByteArray &name) -> bool {
+        const int c = scanner.token();
+        if (c == '"')
+        {
+            if (!scanner.parseString(&text))
+                return false;
+
+            bool ok = false;
+            qreal value = QString::fromUtf8(text).toDouble(&ok);
+            if (ok)
+                emitValue(month, QString::fromUtf8(name), value);
+            return true;
+        }
+        if (c == 't' || c == 'f')
+        {
+            if (!scanner.parseLiteral(c == 't'? "true" : "false"))
+                return false;
+
+            emitValue(month, QString::fromUtf8(name), c == 't'? 1 : 0);
+            return true;
+        }
+        if (c == '-' || (c >= '0' && c <= '9'))
+        {
+            qreal value = 0;
+            if (!scanner.parseNumber(&value))
+                return false;
+
+            emitValue(month, QString::fromUtf8(name), value);
+            return true;
+        }
+
+        return scanner.skipValue();
+    });
+}
+
+void JsonStreamReader::Private::emitValue(const QString &month, const QString &property, qreal value)
+{
+    if (labelFound)
+    {
+        callback(label, month, property, value);
+        return;
+    }
+
+    Tuple t;
+    t.month = month;
+    t.property = property;
+    t.value = value;
+    pending << t;
+}
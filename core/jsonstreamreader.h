@@ -0,0 +1,62 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef JSONSTREAMREADER_H
+#define JSONSTREAMREADER_H
+
+#include <QString>
+
+#include <functional>
+
+class QIODevice;
+
+/*!
+ * Pulls the (label, month, property, value) tuples out of an exported chat
+ * summary straight from the byte stream:
+ *
+ *   [ { "label": "...", "months": { "<month>": { "sum": { "<property>": 12, ... } } } }, ... ]
+ *
+ * Only the first record of the top level array is read, like the
+ * QJsonDocument based loader did. Every other part of the document is
+ * skipped without being decoded. Number, boolean and numeric string leaves
+ * of the "sum" objects are reported, anything else is ignored.
+ */
+class JsonStreamReader
+{
+    class Private;
+
+public:
+    typedef std::function<void(const QString &label, const QString &month, const QString &property, qreal value)> Callback;
+
+    JsonStreamReader(QIODevice *device);
+    virtual ~JsonStreamReader();
+
+    bool read(const Callback &callback);
+
+    bool hasRecord() const;
+    QString label() const;
+    QString errorString() const;
+
+    qint64 bytesRead() const;
+    qint64 readTime() const; // Nanoseconds spent waiting on the device
+
+private:
+    Private *p;
+};
+
+#endif // JSONSTREAMREADER_H
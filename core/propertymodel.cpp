@@ -0,0 +1,225 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "propertymodel.h"
+#include "datafetcher_p.h"
+
+#include <algorithm>
+
+class PropertyModel::Private
+{
+public:
+    DataFetcher *fetcher;
+    QSharedPointer<DataFetcher::Private::Model> model;
+    QVector<qint32> rows; // Property ids
+    mutable QHash<qint32, PropertyValueModel*> values;
+};
+
+class PropertyValueModel::Private
+{
+public:
+    QSharedPointer<DataFetcher::Private::Model> model;
+    qint32 property;
+    QVector<qint32> labels;
+    QVector<qint32> offsets; // First row of every label, plus the total
+
+    const DataFetcher::Private::PropertyItem &item() const { return model->properties.at(property); }
+};
+
+PropertyModel::PropertyModel(DataFetcher *fetcher) :
+    QAbstractListModel(fetcher)
+{
+    p = new Private;
+    p->fetcher = fetcher;
+    connect(fetcher, &DataFetcher::sourceChanged, this, &PropertyModel::refresh);
+    refresh();
+}
+
+qint32 PropertyModel::count() const
+{
+    return p->rows.count();
+}
+
+int PropertyModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return p->rows.count();
+}
+
+QVariant PropertyModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= p->rows.count())
+        return QVariant();
+
+    const qint32 id = p->rows.at(index.row());
+    const DataFetcher::Private::PropertyItem &pItem = p->model->properties.at(id);
+    switch (role)
+    {
+    case Qt::DisplayRole:
+    case PropertyRole:
+        return pItem.property;
+    case MinimumRole:
+        return pItem.minimum;
+    case MaximumRole:
+        return pItem.maximum;
+    case CountRole:
+        return pItem.count;
+    case ValuesRole:
+    {
+        PropertyValueModel *model = p->values.value(id);
+        if (model)
+            return QVariant::fromValue<QObject*>(model);
+
+        PropertyValueModel::Private *vp = new PropertyValueModel::Private;
+        vp->model = p->model;
+        vp->property = id;
+        vp->offsets << 0;
+        for (const DataFetcher::Private::PropertyLabel &pLabel: pItem.labels)
+        {
+            if (!pLabel.isValid() || pLabel.values.isEmpty())
+                continue;
+
+            vp->labels << pLabel.labelIndex;
+            vp->offsets << vp->offsets.last() + pLabel.values.count();
+        }
+
+        model = new PropertyValueModel(vp, const_cast<PropertyModel*>(this));
+        p->values[id] = model;
+        return QVariant::fromValue<QObject*>(model);
+    }
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> PropertyModel::roleNames() const
+{
+    return {
+        {PropertyRole, "property"},
+        {MinimumRole, "minimum"},
+        {MaximumRole, "maximum"},
+        {CountRole, "count"},
+        {ValuesRole, "values"}
+    };
+}
+
+void PropertyModel::refresh()
+{
+    const qint32 oldCount = p->rows.count();
+
+    beginResetModel();
+    for (PropertyValueModel *model: p->values)
+        model->deleteLater();
+    p->values.clear();
+
+    p->model = p->fetcher->p->model;
+    p->rows.clear();
+    for (qint32 i=0; i<p->model->properties.count(); i++)
+        if (p->model->properties.at(i).hasRange())
+            p->rows << i;
+
+    const DataFetcher::Private::Model *model = p->model.data();
+    std::sort(p->rows.begin(), p->rows.end(), [model](qint32 a, qint32 b){
+        return model->properties.at(a).property < model->properties.at(b).property;
+    });
+    endResetModel();
+
+    if (oldCount != p->rows.count())
+        Q_EMIT countChanged();
+}
+
+PropertyModel::~PropertyModel()
+{
+    delete p;
+}
+
+
+PropertyValueModel::PropertyValueModel(Private *p, QObject *parent) :
+    QAbstractListModel(parent),
+    p(p)
+{
+}
+
+QString PropertyValueModel::property() const
+{
+    return p->item().property;
+}
+
+qreal PropertyValueModel::minimum() const
+{
+    return p->item().minimum;
+}
+
+qreal PropertyValueModel::maximum() const
+{
+    return p->item().maximum;
+}
+
+qint32 PropertyValueModel::count() const
+{
+    return p->offsets.last();
+}
+
+int PropertyValueModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return p->offsets.last();
+}
+
+QVariant PropertyValueModel::data(const QModelIndex &index, int role) const
+{
+    const qint32 row = index.row();
+    if (!index.isValid() || row >= p->offsets.last())
+        return QVariant();
+
+    const qint32 segment = std::upper_bound(p->offsets.constBegin(), p->offsets.constEnd(), row) - p->offsets.constBegin() - 1;
+    const qint32 label = p->labels.at(segment);
+    const DataFetcher::Private::DataItem &item = p->model->items.at(label);
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+    case ValueRole:
+        return p->item().labels.at(label).values.at(row - p->offsets.at(segment));
+    case LabelRole:
+        return item.label;
+    case LabelIndexRole:
+        return item.index;
+    case ColorRole:
+        return DataFetcher::Private::colorName(item.color);
+    }
+
+    return QVariant();
+}
+
+QHash<int, QByteArray> PropertyValueModel::roleNames() const
+{
+    return {
+        {ValueRole, "value"},
+        {LabelRole, "label"},
+        {LabelIndexRole, "labelIndex"},
+        {ColorRole, "color"}
+    };
+}
+
+PropertyValueModel::~PropertyValueModel()
+{
+    delete p;
+}
@@ -0,0 +1,107 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROPERTYMODEL_H
+#define PROPERTYMODEL_H
+
+#include <QAbstractListModel>
+
+class DataFetcher;
+class PropertyValueModel;
+
+/*!
+ * Lists the properties of the fetcher's model that have a range, sorted by
+ * name. Rows are read straight from the trained model; the values of a
+ * property are only wrapped in a PropertyValueModel when the "values" role
+ * of its row is asked for.
+ */
+class PropertyModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(qint32 count READ count NOTIFY countChanged)
+    class Private;
+
+public:
+    enum Roles {
+        PropertyRole = Qt::UserRole + 1,
+        MinimumRole,
+        MaximumRole,
+        CountRole,
+        ValuesRole
+    };
+
+    PropertyModel(DataFetcher *fetcher);
+    virtual ~PropertyModel();
+
+    qint32 count() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    QHash<int, QByteArray> roleNames() const Q_DECL_OVERRIDE;
+
+public Q_SLOTS:
+    void refresh();
+
+Q_SIGNALS:
+    void countChanged();
+
+private:
+    Private *p;
+};
+
+/*!
+ * The training values of one property, label by label. Rows are mapped
+ * to (label, value) on the fly through per-label offsets.
+ */
+class PropertyValueModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString property READ property CONSTANT)
+    Q_PROPERTY(qreal minimum READ minimum CONSTANT)
+    Q_PROPERTY(qreal maximum READ maximum CONSTANT)
+    Q_PROPERTY(qint32 count READ count CONSTANT)
+    class Private;
+    friend class PropertyModel;
+
+public:
+    enum Roles {
+        ValueRole = Qt::UserRole + 1,
+        LabelRole,
+        LabelIndexRole,
+        ColorRole
+    };
+
+    virtual ~PropertyValueModel();
+
+    QString property() const;
+    qreal minimum() const;
+    qreal maximum() const;
+    qint32 count() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    QHash<int, QByteArray> roleNames() const Q_DECL_OVERRIDE;
+
+private:
+    PropertyValueModel(Private *p, QObject *parent);
+
+private:
+    Private *p;
+};
+
+#endif // PROPERTYMODEL_H
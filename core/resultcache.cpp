@@ -0,0 +1,190 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resultcache.h"
+
+#define STALE_VERSION_DAYS 30
+#define CACHE_ROOT "tganalizer-results"
+#define CACHE_TAG "CACHEDIR.TAG"
+#define CACHE_TAG_SIGNATURE "Signature: 8a477f597d28d172789f06886806bc55"
+
+#include <QDateTime>
+#include <QDir>
+#include <QRegularExpression>
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonDocument>
+
+ResultCache::ResultCache() :
+    memory(256)
+{
+}
+
+qint32 ResultCache::capacity() const
+{
+    QMutexLocker locker(&mutex);
+    return memory.maxCost();
+}
+
+void ResultCache::setCapacity(qint32 capacity)
+{
+    QMutexLocker locker(&mutex);
+    memory.setMaxCost(qMax(capacity, 0));
+}
+
+QString ResultCache::directory() const
+{
+    QMutexLocker locker(&mutex);
+    return dir;
+}
+
+void ResultCache::setDirectory(const QString &directory)
+{
+    {
+        QMutexLocker locker(&mutex);
+        dir = directory;
+    }
+
+    // Versions of models nobody trains or loads any more never get a new
+    // entry, so their directories stop changing and are dropped after a
+    // while. Only a root the cache tagged itself is touched, and in it only
+    // names the cache hands out, whatever else the directory holds.
+    if (directory.isEmpty() || !isOwned(root(directory)))
+        return;
+
+    static const QRegularExpression name("^([0-9a-f]{40}|untrained)$");
+    const QDateTime stale = QDateTime::currentDateTime().addDays(-STALE_VERSION_DAYS);
+    for (const QFileInfo &info: QDir(root(directory)).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks))
+        if (name.match(info.fileName()).hasMatch() && info.lastModified() < stale)
+            QDir(info.filePath()).removeRecursively();
+}
+
+bool ResultCache::isEnabled() const
+{
+    QMutexLocker locker(&mutex);
+    return memory.maxCost() || !dir.isEmpty();
+}
+
+// The lock only covers the memory tier, files are read and written outside
+// of it so one caller's disk I/O never holds up the others. Entries are
+// written through QSaveFile, so a reader sees a whole file or none.
+
+bool ResultCache::find(const QByteArray &version, const QByteArray &key, QVariantMap *value, bool *disk)
+{
+    QString directory;
+    {
+        QMutexLocker locker(&mutex);
+        if (QVariantMap *cached = memory.object(key))
+        {
+            *value = *cached;
+            if (disk)
+                *disk = false;
+            return true;
+        }
+        directory = dir;
+    }
+
+    if (directory.isEmpty())
+        return false;
+
+    QFile file(path(directory, version, key));
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject())
+        return false;
+
+    *value = doc.toVariant().toMap();
+    if (disk)
+        *disk = true;
+
+    QMutexLocker locker(&mutex);
+    memory.insert(key, new QVariantMap(*value));
+    return true;
+}
+
+void ResultCache::insert(const QByteArray &version, const QByteArray &key, const QVariantMap &value)
+{
+    QString directory;
+    {
+        QMutexLocker locker(&mutex);
+        memory.insert(key, new QVariantMap(value));
+        directory = dir;
+    }
+
+    if (directory.isEmpty() || !QDir().mkpath(path(directory, version)) || !tag(root(directory)))
+        return;
+
+    QSaveFile file(path(directory, version, key));
+    if (file.open(QFile::WriteOnly))
+    {
+        file.write(QJsonDocument::fromVariant(value).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
+
+void ResultCache::invalidate(const QByteArray &version, bool removeFiles)
+{
+    QString directory;
+    {
+        QMutexLocker locker(&mutex);
+        memory.clear();
+        directory = dir;
+    }
+
+    if (removeFiles && !directory.isEmpty())
+        QDir(path(directory, version)).removeRecursively();
+}
+
+QString ResultCache::root(const QString &directory)
+{
+    return directory + "/" CACHE_ROOT;
+}
+
+// The root is marked with a CACHEDIR.TAG, which backup tools skip as well.
+bool ResultCache::tag(const QString &root)
+{
+    if (isOwned(root))
+        return true;
+
+    QSaveFile file(root + "/" CACHE_TAG);
+    if (!file.open(QFile::WriteOnly))
+        return false;
+
+    file.write(CACHE_TAG_SIGNATURE "\n# Classification results of TgAnalizer, safe to delete.\n");
+    return file.commit();
+}
+
+bool ResultCache::isOwned(const QString &root)
+{
+    QFile file(root + "/" CACHE_TAG);
+    return file.open(QFile::ReadOnly) && file.readLine().trimmed() == CACHE_TAG_SIGNATURE;
+}
+
+QString ResultCache::path(const QString &directory, const QByteArray &version, const QByteArray &key)
+{
+    QString res = root(directory) + "/" + (version.isEmpty()? QString("untrained") : QString::fromLatin1(version.toHex()));
+    if (!key.isEmpty())
+        res += "/" + QString::fromLatin1(key.toHex()) + ".json";
+    return res;
+}
+
+ResultCache::~ResultCache()
+{
+}
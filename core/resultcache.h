@@ -0,0 +1,67 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+
+/*!
+ * Classification results by key, in a bounded in-memory LRU and
+ * optionally on disk in a tagged tganalizer-results folder of \a directory,
+ * one subdirectory per model version. Nothing outside that folder is ever
+ * written or removed. Keys already cover the model, so a stale entry is
+ * never hit, invalidate() only reclaims the space. All methods are thread
+ * safe.
+ */
+class ResultCache
+{
+public:
+    ResultCache();
+    virtual ~ResultCache();
+
+    qint32 capacity() const;
+    void setCapacity(qint32 capacity); // Entries kept in memory, 0 turns the tier off
+
+    QString directory() const;
+    void setDirectory(const QString &directory); // Empty turns the disk tier off, stale versions are pruned
+
+    bool isEnabled() const;
+
+    bool find(const QByteArray &version, const QByteArray &key, QVariantMap *value, bool *disk = Q_NULLPTR); // disk: the entry came from a file
+    void insert(const QByteArray &version, const QByteArray &key, const QVariantMap &value);
+
+    // Drops the memory tier, and the disk entries of version when asked.
+    void invalidate(const QByteArray &version, bool removeFiles);
+
+private:
+    static QString root(const QString &directory);
+    static bool tag(const QString &root);
+    static bool isOwned(const QString &root);
+    static QString path(const QString &directory, const QByteArray &version, const QByteArray &key = QByteArray());
+
+    mutable QMutex mutex;
+    QCache<QByteArray, QVariantMap> memory;
+    QString dir;
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,105 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "scoringkernel.h"
+
+#include <QtGlobal>
+
+#if defined(Q_PROCESSOR_X86_64) || (defined(Q_PROCESSOR_X86) && defined(__SSE2__))
+#define SCORING_KERNEL_SSE2
+#include <emmintrin.h>
+#if defined(Q_CC_GNU) || defined(Q_CC_CLANG)
+#define SCORING_KERNEL_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+typedef void (*AccumulateFunction)(qreal *rates, const qreal *row, qint32 count);
+
+static void accumulateScalar(qreal *rates, const qreal *row, qint32 count)
+{
+    for (qint32 i=0; i<count; i++)
+        rates[i] += row[i];
+}
+
+#ifdef SCORING_KERNEL_SSE2
+static void accumulateSse2(qreal *rates, const qreal *row, qint32 count)
+{
+    qint32 i = 0;
+    for (; i+2<=count; i+=2)
+        _mm_storeu_pd(rates+i, _mm_add_pd(_mm_loadu_pd(rates+i), _mm_loadu_pd(row+i)));
+    for (; i<count; i++)
+        rates[i] += row[i];
+}
+#endif
+
+#ifdef SCORING_KERNEL_AVX2
+__attribute__((target("avx2")))
+static void accumulateAvx2(qreal *rates, const qreal *row, qint32 count)
+{
+    qint32 i = 0;
+    for (; i+8<=count; i+=8)
+    {
+        _mm256_storeu_pd(rates+i, _mm256_add_pd(_mm256_loadu_pd(rates+i), _mm256_loadu_pd(row+i)));
+        _mm256_storeu_pd(rates+i+4, _mm256_add_pd(_mm256_loadu_pd(rates+i+4), _mm256_loadu_pd(row+i+4)));
+    }
+    for (; i+4<=count; i+=4)
+        _mm256_storeu_pd(rates+i, _mm256_add_pd(_mm256_loadu_pd(rates+i), _mm256_loadu_pd(row+i)));
+    for (; i<count; i++)
+        rates[i] += row[i];
+}
+#endif
+
+class ScoringKernelDispatch
+{
+public:
+    ScoringKernelDispatch() {
+        accumulate = accumulateScalar;
+        instructionSet = "scalar";
+#ifdef SCORING_KERNEL_SSE2
+        accumulate = accumulateSse2;
+        instructionSet = "sse2";
+#endif
+#ifdef SCORING_KERNEL_AVX2
+        if (qgetenv("TGANALIZER_NO_AVX2").isEmpty() && __builtin_cpu_supports("avx2"))
+        {
+            accumulate = accumulateAvx2;
+            instructionSet = "avx2";
+        }
+#endif
+    }
+
+    AccumulateFunction accumulate;
+    QString instructionSet;
+};
+
+static const ScoringKernelDispatch &dispatch()
+{
+    static const ScoringKernelDispatch res;
+    return res;
+}
+
+void ScoringKernel::accumulate(qreal *rates, const qreal *row, qint32 count)
+{
+    dispatch().accumulate(rates, row, count);
+}
+
+QString ScoringKernel::instructionSet()
+{
+    return dispatch().instructionSet;
+}
@@ -0,0 +1,39 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCORINGKERNEL_H
+#define SCORINGKERNEL_H
+
+#include <QString>
+
+/*!
+ * Label parallel scoring primitives. A score row holds the rate of every
+ * label for one histogram index, so scoring a value against all labels of
+ * a property is a single vector add into the per label accumulators.
+ *
+ * The implementation is picked once at runtime: AVX2 or SSE2 on x86 and a
+ * scalar loop everywhere else.
+ */
+class ScoringKernel
+{
+public:
+    static void accumulate(qreal *rates, const qreal *row, qint32 count);
+    static QString instructionSet();
+};
+
+#endif // SCORINGKERNEL_H
@@ -0,0 +1,152 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "streaminghistogram.h"
+
+#include <QtMath>
+
+#include <cmath>
+
+StreamingHistogram::StreamingHistogram(qint32 buckets) :
+    size(qMax(buckets, 2) & ~1),
+    origin(0),
+    width(0),
+    total(0)
+{
+}
+
+void StreamingHistogram::add(qint32 row, qreal value)
+{
+    if (!qIsFinite(value))
+        return;
+
+    if (row >= rowCounts.count())
+    {
+        rowCounts.resize(row+1);
+        counts.resize((row+1) * size);
+        sums.resize((row+1) * size);
+    }
+
+    if (!total)
+        origin = value;
+    else
+        fit(value);
+
+    const qint32 index = width > 0? qBound(0, static_cast<qint32>((value - origin) / width), size-1) : 0;
+    counts[row * size + index]++;
+    sums[row * size + index] += value;
+    rowCounts[row]++;
+    total++;
+}
+
+void StreamingHistogram::fit(qreal value)
+{
+    if (width == 0)
+    {
+        if (value == origin)
+            return;
+
+        // The smallest power of two that keeps both values in one half of
+        // the range. Below origin, the old values move to the middle.
+        int exponent;
+        std::frexp(qAbs(value - origin) / (size / 2), &exponent);
+        width = std::ldexp(1.0, exponent);
+        if (value < origin)
+        {
+            origin -= width * (size / 2);
+            for (qint32 row=0; row<rows(); row++)
+            {
+                qSwap(counts[row * size], counts[row * size + size / 2]);
+                qSwap(sums[row * size], sums[row * size + size / 2]);
+            }
+        }
+        return;
+    }
+
+    // Doubling the width maps bucket i to i/2 when the range grows up, and
+    // to size/2 + i/2 when it grows down. Edges stay edges either way.
+    while (value < origin || value >= origin + width * size)
+    {
+        const bool down = value < origin;
+        const qint32 shift = down? size / 2 : 0;
+
+        QVector<qint64> newCounts(counts.count());
+        QVector<double> newSums(sums.count());
+        for (qint32 row=0; row<rows(); row++)
+            for (qint32 i=0; i<size; i++)
+            {
+                newCounts[row * size + shift + i / 2] += counts.at(row * size + i);
+                newSums[row * size + shift + i / 2] += sums.at(row * size + i);
+            }
+
+        counts.swap(newCounts);
+        sums.swap(newSums);
+        if (down)
+            origin -= width * size;
+        width *= 2;
+    }
+}
+
+qint64 StreamingHistogram::bytes() const
+{
+    return rowCounts.capacity() * sizeof(qint64) + counts.capacity() * sizeof(qint64) + sums.capacity() * sizeof(double);
+}
+
+void StreamingHistogram::bin(qint32 row, qreal minimum, qreal maximum, qreal *function, qint32 resolution) const
+{
+    if (row >= rows() || !rowCounts.at(row) || maximum <= minimum)
+        return;
+
+    const qreal range = maximum - minimum;
+    const qreal n = rowCounts.at(row);
+    const qint64 *c = counts.constData() + row * size;
+    const double *s = sums.constData() + row * size;
+    for (qint32 i=0; i<size; i++)
+    {
+        if (!c[i])
+            continue;
+
+        const qint32 index = qBound(0, static_cast<qint32>((s[i] / c[i] - minimum) / range * resolution), resolution-1);
+        function[index] += (s[i] - c[i] * minimum) / range / n;
+    }
+}
+
+qreal StreamingHistogram::quantile(qreal q) const
+{
+    if (!total)
+        return 0;
+
+    const qint64 rank = static_cast<qint64>(q * (total - 1));
+    qint64 seen = 0;
+    for (qint32 i=0; i<size; i++)
+    {
+        qint64 count = 0;
+        double sum = 0;
+        for (qint32 row=0; row<rows(); row++)
+        {
+            count += counts.at(row * size + i);
+            sum += sums.at(row * size + i);
+        }
+
+        seen += count;
+        if (seen > rank)
+            return sum / count;
+    }
+
+    return origin;
+}
@@ -0,0 +1,66 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STREAMINGHISTOGRAM_H
+#define STREAMINGHISTOGRAM_H
+
+#include <QtGlobal>
+#include <QVector>
+
+/*!
+ * Count and sum of the values in equal width buckets, one row per label,
+ * over a range that grows as values arrive. The bucket width is a power of
+ * two and the range only ever doubles, so growing merges whole buckets and
+ * no value has to be seen again. Memory depends on the bucket count and
+ * the rows, never on how many values were added.
+ */
+class StreamingHistogram
+{
+public:
+    StreamingHistogram(qint32 buckets = 8192);
+
+    void add(qint32 row, qreal value); // Non finite values are dropped
+
+    bool isEmpty() const { return !total; }
+    qint32 rows() const { return rowCounts.count(); }
+    qint32 buckets() const { return size; }
+    qint64 count(qint32 row) const { return rowCounts.value(row); }
+    qint64 bytes() const;
+
+    // Adds the values of row to the resolution bins of function over
+    // [minimum, maximum], each weighted by its normalized position and
+    // divided by the row count. A bucket goes to the bin of its mean as a
+    // whole, so only buckets crossing a bin edge are off.
+    void bin(qint32 row, qreal minimum, qreal maximum, qreal *function, qint32 resolution) const;
+
+    // Of all rows, as the mean of the bucket holding that rank.
+    qreal quantile(qreal q) const;
+
+private:
+    void fit(qreal value);
+
+    qint32 size;
+    qreal origin;
+    qreal width; // 0 while every value was equal to origin
+    qint64 total;
+    QVector<qint64> rowCounts;
+    QVector<qint64> counts; // rows x size
+    QVector<double> sums;
+};
+
+#endif // STREAMINGHISTOGRAM_H
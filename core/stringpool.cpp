@@ -0,0 +1,65 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stringpool.h"
+
+StringPool::StringPool()
+{
+}
+
+qint32 StringPool::intern(const QString &string)
+{
+    QHash<QString, qint32>::ConstIterator it = hash.constFind(string);
+    if (it != hash.constEnd())
+        return it.value();
+
+    const qint32 id = list.count();
+    hash.insert(string, id);
+    list << string;
+    return id;
+}
+
+qint32 StringPool::id(const QString &string) const
+{
+    return hash.value(string, -1);
+}
+
+QString StringPool::string(qint32 id) const
+{
+    return list.value(id);
+}
+
+qint32 StringPool::count() const
+{
+    return list.count();
+}
+
+QStringList StringPool::strings() const
+{
+    return list.toList();
+}
+
+void StringPool::clear()
+{
+    hash.clear();
+    list.clear();
+}
+
+StringPool::~StringPool()
+{
+}
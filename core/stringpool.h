@@ -0,0 +1,51 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+
+/*!
+ * Maps strings to dense integer ids, in order of first appearance, so the
+ * model can keep its tables in flat arrays indexed by those ids.
+ */
+class StringPool
+{
+public:
+    StringPool();
+    virtual ~StringPool();
+
+    qint32 intern(const QString &string);
+    qint32 id(const QString &string) const;
+    QString string(qint32 id) const;
+
+    qint32 count() const;
+    QStringList strings() const;
+
+    void clear();
+
+private:
+    QHash<QString, qint32> hash;
+    QVector<QString> list;
+};
+
+#endif // STRINGPOOL_H
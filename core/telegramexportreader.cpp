@@ -0,0 +1,425 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "telegramexportreader.h"
+#include "jsonscanner.h"
+
+#include <QMap>
+#include <QSet>
+#include <QtAlgorithms>
+
+namespace {
+
+enum Property {
+    Messages,
+    Characters,
+    Words,
+    Questions,
+    Links,
+    Photos,
+    Videos,
+    VoiceMessages,
+    VideoMessages,
+    Stickers,
+    Animations,
+    Files,
+    Forwards,
+    Replies,
+    Edited,
+    Calls,
+    CallSeconds,
+    NightMessages,
+    ActiveDays,
+    Senders,
+    PropertiesCount
+};
+
+const char *propertyNames[PropertiesCount] = {
+    "messages", "characters", "words", "questions", "links", "photos", "videos",
+    "voice messages", "video messages", "stickers", "animations", "files", "forwards",
+    "replies", "edited", "calls", "call seconds", "night messages", "active days", "senders"
+};
+
+}
+
+class TelegramExportReader::Private
+{
+public:
+    class Month
+    {
+    public:
+        qreal sums[PropertiesCount] = {};
+        QSet<QByteArray> senders;
+        quint32 days = 0; // Bit per day of the month
+    };
+
+    class Message
+    {
+    public:
+        QByteArray type;
+        QByteArray date;
+        QByteArray from;
+        QByteArray mediaType;
+        QByteArray action;
+        qreal characters = 0;
+        qreal words = 0;
+        qreal links = 0;
+        qreal duration = 0;
+        bool question = false;
+        bool photo = false;
+        bool file = false;
+        bool forwarded = false;
+        bool reply = false;
+        bool edited = false;
+    };
+
+    Private(QIODevice *device) : scanner(device) {}
+
+    JsonScanner scanner;
+    QMap<QString, Month> months;
+    QByteArray lastMonth; // Messages come in order, so the last month is
+    Month *last = Q_NULLPTR; // looked up only when it changes
+    QString chatName;
+    bool hasChat = false;
+
+    QByteArray text;
+
+    bool parseChats();
+    bool parseChat();
+    bool parseMessage();
+    bool parseText(Message *message);
+    bool parseId(QByteArray *out);
+    static void addText(Message *message, const QByteArray &utf8);
+    void addMessage(const Message &message);
+};
+
+TelegramExportReader::TelegramExportReader(QIODevice *device)
+{
+    p = new Private(device);
+}
+
+bool TelegramExportReader::read(const Callback &callback)
+{
+    QString name;
+    const bool ok = p->scanner.parseObject([this, &name](const QByteArray &key) -> bool {
+        // A single chat export is the chat object itself.
+        if (key == "messages" && !p->hasChat && p->scanner.token() == '[')
+        {
+            p->hasChat = true;
+            return p->scanner.parseArray([this](){ return p->parseMessage(); });
+        }
+        if (key == "name" && p->scanner.token() == '"')
+        {
+            if (!p->scanner.parseString(&p->text))
+                return false;
+            name = QString::fromUtf8(p->text);
+            return true;
+        }
+        if (key == "chats" && !p->hasChat && p->scanner.token() == '{')
+            return p->parseChats();
+
+        return p->scanner.skipValue();
+    });
+    if (!ok)
+        return false;
+
+    if (p->chatName.isEmpty())
+        p->chatName = name;
+
+    QMapIterator<QString, Private::Month> i(p->months);
+    while (i.hasNext())
+    {
+        i.next();
+        Private::Month month = i.value();
+        month.sums[ActiveDays] = qPopulationCount(month.days);
+        month.sums[Senders] = month.senders.count();
+        for (qint32 j=0; j<PropertiesCount; j++)
+            callback(QString(), i.key(), QString::fromLatin1(propertyNames[j]), month.sums[j]);
+    }
+
+    return true;
+}
+
+bool TelegramExportReader::hasChat() const
+{
+    return p->hasChat;
+}
+
+QString TelegramExportReader::chatName() const
+{
+    return p->chatName;
+}
+
+QString TelegramExportReader::errorString() const
+{
+    return p->scanner.errorString();
+}
+
+qint64 TelegramExportReader::bytesRead() const
+{
+    return p->scanner.bytesRead();
+}
+
+qint64 TelegramExportReader::readTime() const
+{
+    return p->scanner.readTime();
+}
+
+QStringList TelegramExportReader::properties()
+{
+    QStringList res;
+    for (const char *name: propertyNames)
+        res << QString::fromLatin1(name);
+    return res;
+}
+
+TelegramExportReader::~TelegramExportReader()
+{
+    delete p;
+}
+
+
+bool TelegramExportReader::Private::parseChats()
+{
+    return scanner.parseObject([this](const QByteArray &key) -> bool {
+        if (key != "list" || scanner.token() != '[')
+            return scanner.skipValue();
+
+        return scanner.parseArray([this]() -> bool {
+            if (hasChat || scanner.token() != '{')
+                return scanner.skipValue();
+            return parseChat();
+        });
+    });
+}
+
+bool TelegramExportReader::Private::parseChat()
+{
+    QByteArray type;
+    QString name;
+    const bool ok = scanner.parseObject([this, &type, &name](const QByteArray &key) -> bool {
+        if (key == "type" && scanner.token() == '"')
+            return scanner.parseString(&type);
+        if (key == "name" && scanner.token() == '"')
+        {
+            if (!scanner.parseString(&text))
+                return false;
+            name = QString::fromUtf8(text);
+            return true;
+        }
+        // Telegram writes the type first, so other chats are skipped
+        // without being folded.
+        if (key == "messages" && scanner.token() == '[' && (type.isEmpty() || type == "personal_chat"))
+            return scanner.parseArray([this](){ return parseMessage(); });
+
+        return scanner.skipValue();
+    });
+    if (!ok)
+        return false;
+
+    if (!type.isEmpty() && type != "personal_chat")
+    {
+        months.clear();
+        last = Q_NULLPTR;
+        return true;
+    }
+
+    hasChat = true;
+    chatName = name;
+    return true;
+}
+
+bool TelegramExportReader::Private::parseMessage()
+{
+    if (scanner.token() != '{')
+        return scanner.skipValue();
+
+    Message message;
+    const bool ok = scanner.parseObject([this, &message](const QByteArray &key) -> bool {
+        const int c = scanner.token();
+        if (key == "type" && c == '"')
+            return scanner.parseString(&message.type);
+        if (key == "date" && c == '"')
+            return scanner.parseString(&message.date);
+        if (key == "from_id" || key == "actor_id")
+            return parseId(&message.from);
+        if (key == "media_type" && c == '"')
+            return scanner.parseString(&message.mediaType);
+        if (key == "action" && c == '"')
+            return scanner.parseString(&message.action);
+        if (key == "duration_seconds" && c != '"' && c != '{' && c != '[')
+            return scanner.parseNumber(&message.duration);
+        if (key == "text")
+            return parseText(&message);
+
+        if (key == "photo")
+            message.photo = true;
+        else if (key == "file")
+            message.file = true;
+        else if (key == "forwarded_from")
+            message.forwarded = true;
+        else if (key == "reply_to_message_id")
+            message.reply = true;
+        else if (key == "edited")
+            message.edited = true;
+
+        return scanner.skipValue();
+    });
+    if (!ok)
+        return false;
+
+    addMessage(message);
+    return true;
+}
+
+bool TelegramExportReader::Private::parseText(Message *message)
+{
+    const int c = scanner.token();
+    if (c == '"')
+    {
+        if (!scanner.parseString(&text))
+            return false;
+        addText(message, text);
+        return true;
+    }
+    if (c != '[')
+        return scanner.skipValue();
+
+    // Formatted text is a list of plain strings and entity objects.
+    return scanner.parseArray([this, message]() -> bool {
+        const int c = scanner.token();
+        if (c == '"')
+        {
+            if (!scanner.parseString(&text))
+                return false;
+            addText(message, text);
+            return true;
+        }
+        if (c != '{')
+            return scanner.skipValue();
+
+        return scanner.parseObject([this, message](const QByteArray &key) -> bool {
+            if (scanner.token() != '"')
+                return scanner.skipValue();
+            if (!scanner.parseString(&text))
+                return false;
+
+            if (key == "text")
+                addText(message, text);
+            else if (key == "type" && (text == "link" || text == "text_link"))
+                message->links++;
+            return true;
+        });
+    });
+}
+
+bool TelegramExportReader::Private::parseId(QByteArray *out)
+{
+    const int c = scanner.token();
+    if (c == '"')
+        return scanner.parseString(out);
+    if (c == '-' || (c >= '0' && c <= '9'))
+    {
+        qreal id = 0;
+        if (!scanner.parseNumber(&id))
+            return false;
+        *out = QByteArray::number(id, 'f', 0);
+        return true;
+    }
+    return scanner.skipValue();
+}
+
+void TelegramExportReader::Private::addText(Message *message, const QByteArray &utf8)
+{
+    bool inWord = false;
+    for (const char byte: utf8)
+    {
+        const uchar c = static_cast<uchar>(byte);
+        if ((c & 0xc0) != 0x80)
+            message->characters++;
+
+        const bool space = (c == ' ' || c == '\n' || c == '\r' || c == '\t');
+        if (!space && !inWord)
+            message->words++;
+        inWord = !space;
+    }
+
+    // '?' or the Arabic question mark U+061F
+    if (utf8.contains('?') || utf8.contains("\xd8\x9f"))
+        message->question = true;
+}
+
+void TelegramExportReader::Private::addMessage(const Message &message)
+{
+    // "2019-01-05T12:34:56"
+    const QByteArray &date = message.date;
+    if (date.size() < 13)
+        return;
+
+    const qint32 day = (date.at(8) - '0') * 10 + (date.at(9) - '0');
+    const qint32 hour = (date.at(11) - '0') * 10 + (date.at(12) - '0');
+    if (!last || !date.startsWith(lastMonth))
+    {
+        lastMonth = date.left(7);
+        last = &months[QString::fromLatin1(lastMonth)];
+    }
+    Month &month = *last;
+
+    if (message.type == "service")
+    {
+        if (message.action == "phone_call")
+        {
+            month.sums[Calls]++;
+            month.sums[CallSeconds] += message.duration;
+        }
+        return;
+    }
+    if (message.type != "message")
+        return;
+
+    qreal *sums = month.sums;
+    sums[Messages]++;
+    sums[Characters] += message.characters;
+    sums[Words] += message.words;
+    sums[Links] += message.links;
+    if (message.question) sums[Questions]++;
+    if (message.forwarded) sums[Forwards]++;
+    if (message.reply) sums[Replies]++;
+    if (message.edited) sums[Edited]++;
+    if (hour < 6) sums[NightMessages]++;
+
+    if (message.photo)
+        sums[Photos]++;
+    else if (message.mediaType == "sticker")
+        sums[Stickers]++;
+    else if (message.mediaType == "voice_message")
+        sums[VoiceMessages]++;
+    else if (message.mediaType == "video_message")
+        sums[VideoMessages]++;
+    else if (message.mediaType == "animation")
+        sums[Animations]++;
+    else if (message.mediaType == "video_file")
+        sums[Videos]++;
+    else if (message.file)
+        sums[Files]++;
+
+    if (day >= 1 && day <= 31)
+        month.days |= 1u << (day - 1);
+    if (!message.from.isEmpty())
+        month.senders.insert(message.from);
+}
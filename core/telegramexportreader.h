@@ -0,0 +1,69 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TELEGRAMEXPORTREADER_H
+#define TELEGRAMEXPORTREADER_H
+
+#include <QString>
+#include <QStringList>
+
+#include "jsonstreamreader.h"
+
+class QIODevice;
+
+/*!
+ * Extracts the monthly "sum" properties straight from a Telegram Desktop
+ * export (result.json), in one streaming pass:
+ *
+ *   { "name": "...", "type": "personal_chat", "messages": [ ... ] }             one chat
+ *   { ..., "chats": { "list": [ { "type": "...", "messages": [ ... ] } ] } }    whole account
+ *
+ * Of a whole account export the first personal chat is read. Messages are
+ * folded into their month as they stream by, so only the month totals are
+ * held in memory, whatever the size of the export. Every property is
+ * reported for every month, with an empty label: raw exports don't carry
+ * one. The property names are the reader's own, see properties(), and
+ * none of them appears in the summaries, so exports are only scored
+ * against models trained on exports.
+ */
+class TelegramExportReader
+{
+    class Private;
+
+public:
+    typedef JsonStreamReader::Callback Callback;
+
+    TelegramExportReader(QIODevice *device);
+    virtual ~TelegramExportReader();
+
+    bool read(const Callback &callback);
+
+    bool hasChat() const;
+    QString chatName() const;
+    QString errorString() const;
+
+    qint64 bytesRead() const;
+    qint64 readTime() const; // Nanoseconds spent waiting on the device
+
+    static QStringList properties();
+
+private:
+    Private *p;
+};
+
+#endif // TELEGRAMEXPORTREADER_H
@@ -0,0 +1,82 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tracer.h"
+
+#include <QSaveFile>
+#include <QThread>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+
+Tracer::Tracer()
+{
+    timer.start();
+}
+
+void Tracer::addEvent(const char *name, const QString &detail, qint64 begin, qint64 end)
+{
+    Event e;
+    e.name = name;
+    e.detail = detail;
+    e.begin = begin;
+    e.end = end;
+    e.thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+
+    QMutexLocker locker(&mutex);
+    events << e;
+}
+
+bool Tracer::save(const QString &path) const
+{
+    QMutexLocker locker(&mutex);
+
+    // Thread handles are replaced by small numbers, in order of appearance.
+    QHash<quintptr, qint32> threads;
+    QJsonArray list;
+    for (const Event &e: events)
+    {
+        if (!threads.contains(e.thread))
+            threads.insert(e.thread, threads.count());
+
+        QJsonObject event;
+        event["name"] = QString::fromLatin1(e.name);
+        event["cat"] = "tganalizer";
+        event["ph"] = "X";
+        event["ts"] = e.begin / 1000.0;
+        event["dur"] = (e.end - e.begin) / 1000.0;
+        event["pid"] = 1;
+        event["tid"] = threads.value(e.thread);
+        if (!e.detail.isEmpty())
+            event["args"] = QJsonObject({ {"detail", e.detail} });
+
+        list << event;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QFile::WriteOnly))
+        return false;
+
+    file.write(QJsonDocument(QJsonObject({ {"traceEvents", list}, {"displayTimeUnit", "ms"} })).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+Tracer::~Tracer()
+{
+}
@@ -0,0 +1,94 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+
+/*!
+ * Collects complete ("ph": "X") trace events from any thread and writes
+ * them in the Chrome trace-event format, which chrome://tracing and
+ * Perfetto open directly.
+ */
+class Tracer
+{
+public:
+    Tracer();
+    virtual ~Tracer();
+
+    qint64 elapsed() const { return timer.nsecsElapsed(); }
+    void addEvent(const char *name, const QString &detail, qint64 begin, qint64 end);
+
+    bool save(const QString &path) const;
+
+private:
+    class Event
+    {
+    public:
+        const char *name;
+        QString detail;
+        qint64 begin;
+        qint64 end;
+        quintptr thread;
+    };
+
+    QElapsedTimer timer;
+    mutable QMutex mutex;
+    QVector<Event> events;
+};
+
+/*!
+ * Adds the time spent in a scope to \a total. A trace event is recorded
+ * only when \a tracer is set, so with tracing off a scope is two clock
+ * reads and an atomic add.
+ */
+class ScopedTimer
+{
+public:
+    ScopedTimer(QAtomicInteger<qint64> *total, Tracer *tracer = Q_NULLPTR, const char *name = Q_NULLPTR, const QString &detail = QString()) :
+        total(total), tracer(tracer), name(name) {
+        if (tracer)
+        {
+            this->detail = detail;
+            begin = tracer->elapsed();
+        }
+        timer.start();
+    }
+    ~ScopedTimer() {
+        const qint64 nsecs = timer.nsecsElapsed();
+        if (total)
+            total->fetchAndAddRelaxed(nsecs);
+        if (tracer)
+            tracer->addEvent(name, detail, begin, begin + nsecs);
+    }
+
+private:
+    QElapsedTimer timer;
+    QAtomicInteger<qint64> *total;
+    Tracer *tracer;
+    const char *name;
+    QString detail;
+    qint64 begin = 0;
+};
+
+#endif // TRACER_H
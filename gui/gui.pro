@@ -0,0 +1,16 @@
+TARGET = TgAnalizer
+QT += quick widgets
+CONFIG += c++11
+
+include(../core/core.pri)
+
+SOURCES += \
+    asemantools.cpp \
+    main.cpp \
+    propertychart.cpp
+
+RESOURCES += qml.qrc
+
+HEADERS += \
+    asemantools.h \
+    propertychart.h
@@ -24,11 +24,13 @@
 
 #include "asemantools.h"
 #include "datafetcher.h"
+#include "propertychart.h"
 
 int main(int argc, char *argv[])
 {
     qsrand(1601353213);
     qmlRegisterType<DataFetcher>("TgAnalizer", 1, 0, "DataFetcher");
+    qmlRegisterType<PropertyChart>("TgAnalizer", 1, 0, "PropertyChart");
     qmlRegisterSingletonType<AsemanTools>("TgAnalizer", 1, 0, "Tools", [](QQmlEngine *, QJSEngine *) -> QObject * {
         return new AsemanTools();
     });
@@ -24,6 +24,10 @@ Window {
 
     DataFetcher {
         id: fetcher
+        asynchronous: true
+        incremental: true
+        onFilesParsed: progressLabel.text = qsTr("Parsing files: %1/%2").arg(count).arg(total)
+        onPropertiesBinned: progressLabel.text = qsTr("Binning properties: %1/%2").arg(count).arg(total)
         mergables: {
             if (!mixSwitch.checked)
                 return new Array
@@ -66,24 +70,23 @@ Window {
 
                     Repeater {
                         id: mainRepeater
-                        model: fetcher.byProperties
+                        model: fetcher.propertyModel
 
                         Item {
                             id: item
                             height: parent.height
                             width: 80
 
-                            property variant list: modelData.list
-                            property real maximum: modelData.maximum
-                            property real minimum: modelData.minimum
-                            property string property: modelData.property
+                            property real maximum: model.maximum
+                            property real minimum: model.minimum
+                            property string property: model.property
 
                             Label {
                                 id: label
                                 anchors.horizontalCenter: parent.horizontalCenter
                                 anchors.bottom: parent.bottom
                                 anchors.bottomMargin: index%2==0? 20 : 0
-                                text: modelData.property
+                                text: item.property
                                 font.pointSize: 9
                             }
 
@@ -121,36 +124,10 @@ Window {
                                 anchors.bottom: rect.top
                                 clip: true
 
-                                Repeater {
-                                    model: item.list
-
-                                    Rectangle {
-                                        x: modelData.labelIndex * parent.width/propertyLabelsRepeater.count
-                                        color: modelData.color
-                                        width: parent.width / propertyLabelsRepeater.count
-                                        height: 1
-                                        y: parent.height - ((modelData.value - item.minimum) * (parent.height - 1) / (item.maximum - item.minimum)) - height/2
-                                    }
-                                }
-
-                                Repeater {
-                                    model: {
-                                        var res = new Array
-                                        try {
-                                            res = fetcher.checkedMap[item.property]
-                                        } catch (e) {
-                                        }
-                                        if (res == undefined)
-                                            res = new Array
-                                        return res
-                                    }
-
-                                    Rectangle {
-                                        color: "#18f"
-                                        width: parent.width
-                                        height: 3
-                                        y: parent.height - ((modelData.value - item.minimum) * (parent.height - 1) / (item.maximum - item.minimum)) - height/2
-                                    }
+                                PropertyChart {
+                                    anchors.fill: parent
+                                    dataFetcher: fetcher
+                                    propertyName: item.property
                                 }
                             }
                         }
@@ -163,7 +140,26 @@ Window {
     BusyIndicator {
         id: indicator
         anchors.centerIn: parent
-        running: false
+        running: fetcher.training
+    }
+
+    Column {
+        anchors.top: indicator.bottom
+        anchors.horizontalCenter: parent.horizontalCenter
+        anchors.topMargin: 10
+        spacing: 10
+        visible: indicator.running
+
+        Label {
+            id: progressLabel
+            anchors.horizontalCenter: parent.horizontalCenter
+        }
+
+        Button {
+            text: "Cancel"
+            anchors.horizontalCenter: parent.horizontalCenter
+            onClicked: fetcher.cancel()
+        }
     }
 
     Column {
@@ -172,7 +168,7 @@ Window {
         anchors.top: parent.top
         anchors.margins: 10
         spacing: 2
-        visible: mainRepeater.count != 0
+        visible: mainRepeater.count != 0 && !indicator.running
 
         Repeater {
             id: propertyLabelsRepeater
@@ -292,11 +288,11 @@ Window {
 
         settings.lastLearnPath = source
 
-        indicator.running = true
-        Tools.jsDelayCall(100, function(){
+        progressLabel.text = ""
+        if (fetcher.source == source)
+            fetcher.refresh()
+        else
             fetcher.source = source
-            indicator.running = false
-        })
     }
 
     function open() {
@@ -308,7 +304,7 @@ Window {
 
         var res = fetcher.check(file)
 
-        resultLabel.text = res.result
+        resultLabel.text = res.error? qsTr("Can't classify: %1").arg(res.error) : res.result
         stringLabel.text = res.string
         percentsLabel.text = res.percents
         win.title = qsTr("Analizer: %1").arg(Tools.fileName(file))
@@ -0,0 +1,290 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "propertychart.h"
+
+#include <QSGGeometryNode>
+#include <QSGVertexColorMaterial>
+#include <QtMath>
+
+class PropertyChart::Private
+{
+public:
+    QPointer<DataFetcher> fetcher;
+    QString propertyName;
+    QColor markerColor = QColor("#18f");
+
+    QVector<qint32> labels;
+    QVector<qreal> values;
+    QVector<qreal> markers;
+    QVector<QColor> colors;
+    qreal minimum = 0;
+    qreal maximum = 0;
+
+    // Values counted per (label, pixel row) cell, rebuilt only when the
+    // values or the row count change.
+    QVector<qint32> cells;
+    qint32 rows = 0;
+    qint32 maxCount = 0;
+    qint32 occupied = 0;
+
+    bool cellsDirty = true;
+    bool markersDirty = true;
+
+    void buildCells(qint32 rows);
+    static QSGGeometryNode *createNode();
+};
+
+void PropertyChart::Private::buildCells(qint32 count)
+{
+    const qint32 columns = colors.count();
+    const qreal range = maximum - minimum;
+
+    rows = count;
+    cells.fill(0, columns * qMax(rows, 0));
+    maxCount = 0;
+    occupied = 0;
+    cellsDirty = true;
+    if (columns == 0 || range <= 0 || rows < 1)
+        return;
+
+    for (qint32 i=0; i<values.count(); i++)
+    {
+        const qint32 label = labels.at(i);
+        if (label < 0 || label >= columns)
+            continue;
+
+        const qint32 row = qBound(0, qRound((values.at(i) - minimum) * (rows - 1) / range), rows - 1);
+        qint32 &cell = cells[label * rows + row];
+        if (cell == 0)
+            occupied++;
+        cell++;
+        maxCount = qMax(maxCount, cell);
+    }
+}
+
+QSGGeometryNode *PropertyChart::Private::createNode()
+{
+    QSGGeometryNode *node = new QSGGeometryNode;
+    QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0);
+    geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+    node->setGeometry(geometry);
+    node->setFlag(QSGNode::OwnsGeometry);
+    node->setMaterial(new QSGVertexColorMaterial);
+    node->setFlag(QSGNode::OwnsMaterial);
+    return node;
+}
+
+// The vertex color material expects premultiplied colors.
+static void addRect(QSGGeometry::ColoredPoint2D *&v, qreal x, qreal y, qreal width, qreal height, const QColor &color, qreal alpha)
+{
+    const float a = color.alphaF() * alpha;
+    const uchar r = color.redF() * a * 255;
+    const uchar g = color.greenF() * a * 255;
+    const uchar b = color.blueF() * a * 255;
+    const uchar ua = a * 255;
+    const float x1 = x, y1 = y, x2 = x + width, y2 = y + height;
+    v[0].set(x1, y1, r, g, b, ua);
+    v[1].set(x2, y1, r, g, b, ua);
+    v[2].set(x1, y2, r, g, b, ua);
+    v[3].set(x2, y1, r, g, b, ua);
+    v[4].set(x2, y2, r, g, b, ua);
+    v[5].set(x1, y2, r, g, b, ua);
+    v += 6;
+}
+
+PropertyChart::PropertyChart(QQuickItem *parent) :
+    QQuickItem(parent)
+{
+    p = new Private;
+    setFlag(ItemHasContents, true);
+}
+
+DataFetcher *PropertyChart::dataFetcher() const
+{
+    return p->fetcher;
+}
+
+void PropertyChart::setDataFetcher(DataFetcher *fetcher)
+{
+    if (p->fetcher == fetcher)
+        return;
+
+    if (p->fetcher)
+        disconnect(p->fetcher.data(), Q_NULLPTR, this, Q_NULLPTR);
+
+    p->fetcher = fetcher;
+    if (p->fetcher)
+    {
+        connect(p->fetcher.data(), &DataFetcher::sourceChanged, this, &PropertyChart::reload);
+        connect(p->fetcher.data(), &DataFetcher::checkedMapChanged, this, &PropertyChart::reloadMarkers);
+    }
+
+    reload();
+    Q_EMIT dataFetcherChanged();
+}
+
+QString PropertyChart::propertyName() const
+{
+    return p->propertyName;
+}
+
+void PropertyChart::setPropertyName(const QString &propertyName)
+{
+    if (p->propertyName == propertyName)
+        return;
+
+    p->propertyName = propertyName;
+    reload();
+    Q_EMIT propertyNameChanged();
+}
+
+QColor PropertyChart::markerColor() const
+{
+    return p->markerColor;
+}
+
+void PropertyChart::setMarkerColor(const QColor &markerColor)
+{
+    if (p->markerColor == markerColor)
+        return;
+
+    p->markerColor = markerColor;
+    p->markersDirty = true;
+    update();
+    Q_EMIT markerColorChanged();
+}
+
+qint32 PropertyChart::count() const
+{
+    return p->values.count();
+}
+
+void PropertyChart::reload()
+{
+    const qint32 oldCount = p->values.count();
+
+    p->labels.clear();
+    p->values.clear();
+    p->colors.clear();
+    p->minimum = p->maximum = 0;
+    if (p->fetcher && !p->propertyName.isEmpty() &&
+        p->fetcher->propertyValues(p->propertyName, &p->labels, &p->values, &p->minimum, &p->maximum))
+    {
+        for (quint32 color: p->fetcher->labelColors())
+            p->colors << QColor::fromRgba(color);
+    }
+
+    p->buildCells(qFloor(height()));
+    reloadMarkers();
+    if (oldCount != p->values.count())
+        Q_EMIT countChanged();
+}
+
+void PropertyChart::reloadMarkers()
+{
+    p->markers.clear();
+    if (p->fetcher && !p->propertyName.isEmpty())
+        for (const QVariant &v: p->fetcher->checkedMap().value(p->propertyName).toList())
+            p->markers << v.toMap().value("value").toReal();
+
+    p->markersDirty = true;
+    update();
+}
+
+void PropertyChart::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+    if (qFloor(newGeometry.height()) != p->rows)
+        p->buildCells(qFloor(newGeometry.height()));
+    if (newGeometry.size() != oldGeometry.size())
+        p->cellsDirty = p->markersDirty = true;
+    update();
+}
+
+QSGNode *PropertyChart::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    const qreal w = width();
+    const qreal h = height();
+    const qint32 columns = p->colors.count();
+    const qreal range = p->maximum - p->minimum;
+    if (columns == 0 || range <= 0 || w <= 0 || h < 1 || p->rows < 1)
+    {
+        delete oldNode;
+        p->cellsDirty = p->markersDirty = true;
+        return Q_NULLPTR;
+    }
+
+    // Cells and markers are separate nodes, so a new check only rewrites
+    // the few marker vertices.
+    QSGNode *node = oldNode;
+    if (!node)
+    {
+        node = new QSGNode;
+        node->appendChildNode(Private::createNode());
+        node->appendChildNode(Private::createNode());
+        p->cellsDirty = p->markersDirty = true;
+    }
+
+    if (p->cellsDirty)
+    {
+        // Level of detail: every occupied (label, pixel row) cell becomes
+        // one rectangle.
+        QSGGeometryNode *cellsNode = static_cast<QSGGeometryNode*>(node->firstChild());
+        QSGGeometry *geometry = cellsNode->geometry();
+        geometry->allocate(p->occupied * 6);
+        QSGGeometry::ColoredPoint2D *v = geometry->vertexDataAsColoredPoint2D();
+
+        const qreal columnWidth = w / columns;
+        const qreal densityScale = qLn(1 + p->maxCount);
+        for (qint32 label=0; label<columns; label++)
+            for (qint32 row=0; row<p->rows; row++)
+            {
+                const qint32 count = p->cells.at(label * p->rows + row);
+                if (count == 0)
+                    continue;
+
+                const qreal alpha = 0.35 + 0.65 * qLn(1 + count) / densityScale;
+                addRect(v, label * columnWidth, h - 1 - row, columnWidth, 1, p->colors.at(label), alpha);
+            }
+
+        cellsNode->markDirty(QSGNode::DirtyGeometry);
+        p->cellsDirty = false;
+    }
+
+    if (p->markersDirty)
+    {
+        QSGGeometryNode *markersNode = static_cast<QSGGeometryNode*>(node->lastChild());
+        QSGGeometry *geometry = markersNode->geometry();
+        geometry->allocate(p->markers.count() * 6);
+        QSGGeometry::ColoredPoint2D *v = geometry->vertexDataAsColoredPoint2D();
+
+        for (qreal value: p->markers)
+            addRect(v, 0, h - ((value - p->minimum) * (h - 1) / range) - 1.5, w, 3, p->markerColor, 1);
+
+        markersNode->markDirty(QSGNode::DirtyGeometry);
+        p->markersDirty = false;
+    }
+
+    return node;
+}
+
+PropertyChart::~PropertyChart()
+{
+    delete p;
+}
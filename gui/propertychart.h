@@ -0,0 +1,78 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROPERTYCHART_H
+#define PROPERTYCHART_H
+
+#include <QQuickItem>
+#include <QPointer>
+#include <QColor>
+
+#include "datafetcher.h"
+
+/*!
+ * Draws every training value of one property, one column per label, and
+ * the months of the last check on top, as a single geometry node.
+ * Values are aggregated per label and pixel row before drawing, so the
+ * vertex count is bounded by the item size rather than the corpus size;
+ * crowded cells are drawn more opaque. The cells are counted when the
+ * values or the item height change, not on every paint.
+ */
+class PropertyChart : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(DataFetcher* dataFetcher READ dataFetcher WRITE setDataFetcher NOTIFY dataFetcherChanged)
+    Q_PROPERTY(QString propertyName READ propertyName WRITE setPropertyName NOTIFY propertyNameChanged)
+    Q_PROPERTY(QColor markerColor READ markerColor WRITE setMarkerColor NOTIFY markerColorChanged)
+    Q_PROPERTY(qint32 count READ count NOTIFY countChanged)
+    class Private;
+
+public:
+    PropertyChart(QQuickItem *parent = Q_NULLPTR);
+    virtual ~PropertyChart();
+
+    DataFetcher *dataFetcher() const;
+    void setDataFetcher(DataFetcher *fetcher);
+
+    QString propertyName() const;
+    void setPropertyName(const QString &propertyName);
+
+    QColor markerColor() const;
+    void setMarkerColor(const QColor &markerColor);
+
+    qint32 count() const;
+
+Q_SIGNALS:
+    void dataFetcherChanged();
+    void propertyNameChanged();
+    void markerColorChanged();
+    void countChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) Q_DECL_OVERRIDE;
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) Q_DECL_OVERRIDE;
+
+private:
+    void reload();
+    void reloadMarkers();
+
+private:
+    Private *p;
+};
+
+#endif // PROPERTYCHART_H
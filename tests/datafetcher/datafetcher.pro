@@ -0,0 +1,6 @@
+TARGET = datafetchertest
+
+include(../tests.pri)
+
+SOURCES += \
+    datafetchertest.cpp
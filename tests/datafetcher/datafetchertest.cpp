@@ -0,0 +1,895 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+#include <QDirIterator>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QMap>
+#include <QtMath>
+
+#include "datafetcher.h"
+#include "datafetcher_p.h"
+#include "telegramexportreader.h"
+#include "corpusgenerator.h"
+
+/*
+ * Checks the shortcuts of the core against the plain computations they
+ * replaced: merged shards, loaded snapshots and incremental updates
+ * against one training run, the scores table against the smoothing sum and the neighbour
+ * index against the map of buckets it stood in for. Damaged snapshots
+ * have to be rejected, a batch has to agree with check() and a cached
+ * result has to be dropped with the model or the file it came from.
+ * Raw exports train labels of their own and never score against a model
+ * of summaries. A single pass model, binned from histograms, has to stay
+ * close to the two pass one.
+ */
+class DataFetcherTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void mergeModels_data();
+    void mergeModels();
+
+    void saveModel_data();
+    void saveModel();
+
+    void loadModel_data();
+    void loadModel();
+
+    void refresh_data();
+    void refresh();
+
+    void classify_data();
+    void classify();
+
+    void checkCache();
+    void checkExport();
+
+    void singlePass_data();
+    void singlePass();
+
+    void calculateRate_1_data();
+    void calculateRate_1();
+
+    void calculateRate_2_data();
+    void calculateRate_2();
+
+private:
+    static QByteArray chatExport(const QString &name, qint32 length);
+    static void compareModels(const DataFetcher::Private::Model *expected, const DataFetcher::Private::Model *actual);
+    static void addResolutions();
+    static void fillFunction(DataFetcher::Private::PropertyItem *pItem, qint32 resolution, qint32 density);
+    static qreal valueAt(qint32 index, qint32 resolution);
+    static qreal mapRate(const QMap<qint32, qreal> &function, const DataFetcher::Private::PropertyItem &pItem, qint32 count, qreal value);
+};
+
+void DataFetcherTest::initTestCase()
+{
+    qsrand(1601353213);
+}
+
+void DataFetcherTest::mergeModels_data()
+{
+    QTest::addColumn<qint32>("shards");
+    QTest::addColumn<bool>("compact");
+    QTest::newRow("2 shards") << 2 << false;
+    QTest::newRow("3 shards") << 3 << false;
+    QTest::newRow("3 compact shards") << 3 << true;
+}
+
+void DataFetcherTest::mergeModels()
+{
+    QFETCH(qint32, shards);
+    QFETCH(bool, compact);
+
+    CorpusGenerator generator;
+    generator.files = 60;
+    generator.properties = 10;
+
+    // Every file lands in the union and in one shard.
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(generator.generate(dir.filePath("all")));
+
+    QStringList snapshots;
+    for (qint32 s=0; s<shards; s++)
+    {
+        const QString shard = dir.filePath(QString("shard%1").arg(s));
+        QVERIFY(QDir().mkpath(shard));
+        for (qint32 i=s; i<generator.files; i+=shards)
+            QVERIFY(QFile::copy(dir.filePath("all/" + generator.fileName(i)), shard + "/" + generator.fileName(i)));
+
+        DataFetcher fetcher;
+        fetcher.setCompact(compact);
+        fetcher.setSource(shard);
+        snapshots << dir.filePath(QString("shard%1.bin").arg(s));
+        QVERIFY(fetcher.saveModel(snapshots.last(), true));
+    }
+
+    DataFetcher single;
+    single.setCompact(compact);
+    single.setSource(dir.filePath("all"));
+
+    DataFetcher merged;
+    merged.setCompact(compact);
+    QVERIFY(merged.mergeModels(snapshots));
+
+    compareModels(single.p->model.data(), merged.p->model.data());
+}
+
+void DataFetcherTest::compareModels(const DataFetcher::Private::Model *expected, const DataFetcher::Private::Model *actual)
+{
+    // Ids depend on the order names were seen in, so both sides are
+    // matched up by name.
+    QCOMPARE(actual->items.count(), expected->items.count());
+    QCOMPARE(actual->properties.count(), expected->properties.count());
+
+    for (const DataFetcher::Private::PropertyItem &e: expected->properties)
+    {
+        const qint32 property = actual->propertyNames.id(e.property);
+        QVERIFY2(property >= 0, qPrintable(e.property));
+
+        const DataFetcher::Private::PropertyItem &a = actual->properties.at(property);
+        QCOMPARE(a.minimum, e.minimum);
+        QCOMPARE(a.maximum, e.maximum);
+        QCOMPARE(a.count, e.count);
+        QCOMPARE(a.resolution, e.resolution);
+        QCOMPARE(a.functions.isEmpty(), e.functions.isEmpty());
+        if (e.functions.isEmpty())
+            continue;
+
+        for (const DataFetcher::Private::PropertyLabel &eLabel: e.labels)
+        {
+            if (!eLabel.isValid())
+                continue;
+
+            const qint32 label = actual->labelNames.id(expected->items.at(eLabel.labelIndex).label);
+            QVERIFY(label >= 0 && a.contains(label));
+
+            const DataFetcher::Private::PropertyLabel &aLabel = a.labels.at(label);
+            QCOMPARE(aLabel.count(), eLabel.count());
+
+            const qreal *eFunction = eLabel.function(e);
+            const qreal *aFunction = aLabel.function(a);
+            for (qint32 i=0; i<e.resolution; i++)
+                QCOMPARE(aFunction[i], eFunction[i]);
+            for (qint32 r=0; r<=e.resolution; r++)
+                QCOMPARE(a.scores.row(r)[label], e.scores.row(r)[eLabel.labelIndex]);
+        }
+    }
+}
+
+void DataFetcherTest::saveModel_data()
+{
+    QTest::addColumn<qint32>("resolution");
+    QTest::addColumn<bool>("compact");
+    QTest::addColumn<bool>("partial");
+    QTest::newRow("plain") << RESOLUTION << false << false;
+    QTest::newRow("compact") << RESOLUTION << true << false;
+    QTest::newRow("adaptive") << 0 << false << false;
+    QTest::newRow("partial") << RESOLUTION << false << true;
+    QTest::newRow("adaptive partial") << 0 << false << true;
+}
+
+void DataFetcherTest::saveModel()
+{
+    QFETCH(qint32, resolution);
+    QFETCH(bool, compact);
+    QFETCH(bool, partial);
+
+    CorpusGenerator generator;
+    generator.files = 24;
+    generator.properties = 10;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(generator.generate(dir.filePath("corpus")));
+
+    DataFetcher trained;
+    trained.setResolution(resolution);
+    trained.setCompact(compact);
+    trained.setSource(dir.filePath("corpus"));
+
+    const QString snapshot = dir.filePath("model.bin");
+    QVERIFY(trained.saveModel(snapshot, partial));
+
+    DataFetcher::Private::Model model;
+    bool loadedPartial = false;
+    QVERIFY(DataFetcher::Private::loadModel(snapshot, &model, &loadedPartial));
+    QCOMPARE(loadedPartial, partial);
+    QCOMPARE(model.resolution, resolution);
+    QCOMPARE(model.updatable, false);
+    for (qint32 i=0; i<model.items.count(); i++)
+    {
+        QCOMPARE(model.items.at(i).label, trained.p->model->items.at(i).label);
+        QCOMPARE(model.items.at(i).color, trained.p->model->items.at(i).color);
+    }
+
+    // A partial snapshot on its own is binned again when it's loaded,
+    // against the same ranges, so it ends up with the same buckets.
+    DataFetcher loaded;
+    loaded.setCompact(compact);
+    QVERIFY(loaded.loadModel(snapshot));
+    compareModels(trained.p->model.data(), loaded.p->model.data());
+    if (QTest::currentTestFailed())
+        return;
+
+    for (qint32 i=0; i<generator.files; i+=5)
+    {
+        const QString path = dir.filePath("corpus/" + generator.fileName(i));
+        QCOMPARE(loaded.check(path), trained.check(path));
+    }
+}
+
+void DataFetcherTest::loadModel_data()
+{
+    // Header fields are little endian: magic, version, byte order, labels,
+    // properties and entries count, then the resolution at 28.
+    QTest::addColumn<qint64>("size"); // Bytes kept, removed from the end when negative, 0 keeps all
+    QTest::addColumn<qint32>("offset");
+    QTest::addColumn<QByteArray>("patch");
+
+    QTest::newRow("truncated by a byte") << Q_INT64_C(-1) << -1 << QByteArray();
+    QTest::newRow("header only") << Q_INT64_C(64) << -1 << QByteArray();
+    QTest::newRow("half a header") << Q_INT64_C(32) << -1 << QByteArray();
+    QTest::newRow("bad magic") << Q_INT64_C(0) << 0 << QByteArray("XXXX");
+    QTest::newRow("other version") << Q_INT64_C(0) << 8 << QByteArray("\x7f", 1);
+    QTest::newRow("more labels") << Q_INT64_C(0) << 16 << QByteArray("\x7f", 1);
+    QTest::newRow("negative resolution") << Q_INT64_C(0) << 28 << QByteArray("\xff\xff\xff\xff", 4);
+    QTest::newRow("resolution too small") << Q_INT64_C(0) << 28 << QByteArray("\x01\x00\x00\x00", 4);
+    QTest::newRow("resolution too large") << Q_INT64_C(0) << 28 << QByteArray("\x00\x00\x01\x00", 4);
+}
+
+void DataFetcherTest::loadModel()
+{
+    QFETCH(qint64, size);
+    QFETCH(qint32, offset);
+    QFETCH(QByteArray, patch);
+
+    CorpusGenerator generator;
+    generator.files = 8;
+    generator.properties = 3;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(generator.generate(dir.filePath("corpus")));
+
+    DataFetcher trained;
+    trained.setSource(dir.filePath("corpus"));
+
+    const QString snapshot = dir.filePath("model.bin");
+    QVERIFY(trained.saveModel(snapshot));
+
+    {
+        DataFetcher intact;
+        QVERIFY(intact.loadModel(snapshot));
+    }
+
+    QFile file(snapshot);
+    QVERIFY(file.open(QFile::ReadWrite));
+    if (offset >= 0)
+    {
+        QVERIFY(file.seek(offset));
+        QCOMPARE(file.write(patch), static_cast<qint64>(patch.size()));
+    }
+    if (size > 0)
+        QVERIFY(file.resize(size));
+    else if (size < 0)
+        QVERIFY(file.resize(file.size() + size));
+    file.close();
+
+    // A rejected snapshot leaves the current model alone.
+    DataFetcher loaded;
+    loaded.setSource(dir.filePath("corpus"));
+    const QByteArray version = loaded.p->model->version;
+    QVERIFY(!loaded.loadModel(snapshot));
+    QCOMPARE(loaded.p->model->version, version);
+}
+
+void DataFetcherTest::refresh_data()
+{
+    QTest::addColumn<qint32>("added");
+    QTest::addColumn<qint32>("removed");
+    QTest::addColumn<qint32>("labels");
+    QTest::addColumn<qint32>("distribution");
+    QTest::addColumn<bool>("compact");
+
+    QTest::newRow("added") << 6 << 0 << 4 << static_cast<qint32>(CorpusGenerator::Normal) << false;
+    QTest::newRow("removed") << 0 << 6 << 4 << static_cast<qint32>(CorpusGenerator::Normal) << false;
+    QTest::newRow("added and removed") << 6 << 6 << 4 << static_cast<qint32>(CorpusGenerator::Normal) << false;
+    QTest::newRow("range extended") << 6 << 0 << 4 << static_cast<qint32>(CorpusGenerator::Exponential) << false;
+    QTest::newRow("new label") << 10 << 0 << 5 << static_cast<qint32>(CorpusGenerator::Normal) << false;
+    QTest::newRow("compact") << 6 << 6 << 4 << static_cast<qint32>(CorpusGenerator::Normal) << true;
+}
+
+void DataFetcherTest::refresh()
+{
+    QFETCH(qint32, added);
+    QFETCH(qint32, removed);
+    QFETCH(qint32, labels);
+    QFETCH(qint32, distribution);
+    QFETCH(bool, compact);
+
+    CorpusGenerator generator;
+    generator.files = 40;
+    generator.properties = 10;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(generator.generate(dir.path()));
+
+    DataFetcher updated;
+    updated.setIncremental(true);
+    updated.setCompact(compact);
+    updated.setSource(dir.path());
+
+    // New files are numbered after the old ones, so none is overwritten.
+    CorpusGenerator extra;
+    extra.labels = labels;
+    extra.properties = generator.properties;
+    extra.distribution = static_cast<CorpusGenerator::Distribution>(distribution);
+    extra.seed = generator.seed + 1;
+    for (qint32 i=generator.files; i<generator.files + added; i++)
+    {
+        QFile file(dir.filePath(extra.fileName(i)));
+        QVERIFY(file.open(QFile::WriteOnly));
+        QVERIFY(file.write(extra.file(i)) > 0);
+    }
+    for (qint32 i=0; i<removed; i++)
+        QVERIFY(QFile::remove(dir.filePath(generator.fileName(i * 5 + 1))));
+
+    // Only the new files are read again.
+    updated.refresh();
+    QCOMPARE(updated.stats().value("files").toInt(), added);
+
+    DataFetcher retrained;
+    retrained.setCompact(compact);
+    retrained.setSource(dir.path());
+    compareModels(retrained.p->model.data(), updated.p->model.data());
+}
+
+void DataFetcherTest::classify_data()
+{
+    QTest::addColumn<QString>("output");
+    QTest::newRow("callback only") << QString();
+    QTest::newRow("csv") << QString("records.csv");
+    QTest::newRow("json lines") << QString("records.jsonl");
+    QTest::newRow("unwritable") << QString("missing/records.csv");
+}
+
+void DataFetcherTest::classify()
+{
+    QFETCH(QString, output);
+
+    CorpusGenerator generator;
+    generator.files = 20;
+    generator.properties = 10;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(generator.generate(dir.filePath("corpus")));
+
+    DataFetcher fetcher;
+    fetcher.setSource(dir.filePath("corpus"));
+
+    // A directory, a file named on its own and one that can't be read.
+    const QString single = dir.filePath("single.json");
+    const QString broken = dir.filePath("broken.json");
+    QVERIFY(QFile::copy(dir.filePath("corpus/" + generator.fileName(0)), single));
+    {
+        QFile file(broken);
+        QVERIFY(file.open(QFile::WriteOnly));
+        QVERIFY(file.write("[{\"label\":") > 0);
+    }
+
+    QMap<QString, QVariantMap> records;
+    const QString outputPath = output.isEmpty()? QString() : dir.filePath(output);
+    const qint32 count = fetcher.classify({dir.filePath("corpus"), single, broken}, [&records](const QVariantMap &record){
+        records[record.value("path").toString()] = record;
+    }, outputPath);
+
+    if (output.startsWith("missing/"))
+    {
+        QCOMPARE(count, -1);
+        return;
+    }
+
+    QCOMPARE(count, generator.files + 2);
+    QCOMPARE(records.count(), count);
+    QCOMPARE(records.value(broken).value("error").toString(), QString("unreadable"));
+
+    QMapIterator<QString, QVariantMap> i(records);
+    while (i.hasNext())
+    {
+        i.next();
+        if (i.key() == broken)
+            continue;
+
+        const QVariantMap checked = fetcher.check(i.key());
+        QCOMPARE(i.value().value("result"), checked.value("result"));
+        QCOMPARE(i.value().value("rates"), checked.value("rates"));
+
+        // File i is labelled i % labels, the single file is a copy of 0.
+        const qint32 index = (i.key() == single? 0 : QFileInfo(i.key()).baseName().mid(4).toInt());
+        QCOMPARE(i.value().value("label").toString(), generator.labelNames().at(index % generator.labels));
+    }
+
+    if (outputPath.isEmpty())
+        return;
+
+    QFile file(outputPath);
+    QVERIFY(file.open(QFile::ReadOnly));
+    QList<QByteArray> lines = file.readAll().split('\n');
+    QVERIFY(lines.takeLast().isEmpty());
+
+    if (output.endsWith(".csv"))
+    {
+        // Paths hold no commas or quotes here, so the fields split plainly.
+        const QList<QByteArray> header = lines.takeFirst().split(',');
+        QCOMPARE(header.mid(0, 3), QList<QByteArray>({"path", "label", "result"}));
+        QCOMPARE(header.last(), QByteArray("error"));
+        QCOMPARE(lines.count(), count);
+
+        for (const QByteArray &line: lines)
+        {
+            const QList<QByteArray> fields = line.split(',');
+            QCOMPARE(fields.count(), header.count());
+
+            const QVariantMap &record = records.value(QString::fromUtf8(fields.first()));
+            QCOMPARE(QString::fromUtf8(fields.at(2)), record.value("result").toString());
+            QCOMPARE(QString::fromUtf8(fields.last()), record.value("error").toString());
+
+            const QVariantMap rates = record.value("rates").toMap();
+            for (qint32 c=3; c<header.count()-1; c++)
+                if (rates.contains(QString::fromUtf8(header.at(c))))
+                    QCOMPARE(fields.at(c).toDouble(), rates.value(QString::fromUtf8(header.at(c))).toDouble());
+        }
+    }
+    else
+    {
+        QCOMPARE(lines.count(), count);
+        for (const QByteArray &line: lines)
+        {
+            const QVariantMap record = QJsonDocument::fromJson(line).toVariant().toMap();
+            QVERIFY(records.contains(record.value("path").toString()));
+            QCOMPARE(record.value("result"), records.value(record.value("path").toString()).value("result"));
+        }
+    }
+}
+
+void DataFetcherTest::checkCache()
+{
+    CorpusGenerator generator;
+    generator.files = 12;
+    generator.properties = 10;
+
+    CorpusGenerator other = generator;
+    other.seed = generator.seed + 1;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(generator.generate(dir.filePath("a")));
+    QVERIFY(other.generate(dir.filePath("b")));
+
+    const QString target = dir.filePath("target.json");
+    QVERIFY(QFile::copy(dir.filePath("a/" + generator.fileName(0)), target));
+
+    auto uncached = [&target](const QString &source) {
+        DataFetcher fetcher;
+        fetcher.setCacheSize(0);
+        fetcher.setSource(source);
+        return fetcher.check(target);
+    };
+
+    DataFetcher fetcher;
+    fetcher.setCacheDirectory(dir.filePath("cache"));
+    fetcher.setSource(dir.filePath("a"));
+    QCOMPARE(fetcher.check(target), uncached(dir.filePath("a")));
+    QCOMPARE(fetcher.check(target), uncached(dir.filePath("a")));
+
+    // The entry on disk is marked, so a fresh fetcher trained on the same
+    // files shows whether it was used.
+    QStringList entries;
+    QDirIterator it(dir.filePath("cache"), {"*.json"}, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        entries << it.next();
+    QCOMPARE(entries.count(), 1);
+    {
+        QFile file(entries.first());
+        QVERIFY(file.open(QFile::ReadWrite));
+        QVariantMap entry = QJsonDocument::fromJson(file.readAll()).toVariant().toMap();
+        QVariantMap result = entry.value("result").toMap();
+        result["result"] = "cached";
+        entry["result"] = result;
+        QVERIFY(file.resize(0));
+        QVERIFY(file.write(QJsonDocument::fromVariant(entry).toJson()) > 0);
+    }
+    {
+        DataFetcher fresh;
+        fresh.setCacheDirectory(dir.filePath("cache"));
+        fresh.setSource(dir.filePath("a"));
+        QCOMPARE(fresh.check(target).value("result").toString(), QString("cached"));
+    }
+
+    // Another model misses.
+    fetcher.setSource(dir.filePath("b"));
+    QCOMPARE(fetcher.check(target), uncached(dir.filePath("b")));
+
+    // New content of the same size and time: the key still matches, but
+    // the hash kept with a disk entry doesn't.
+    QFile file(target);
+    QVERIFY(file.open(QFile::ReadWrite));
+    const QDateTime modified = file.fileTime(QFileDevice::FileModificationTime);
+    QByteArray data = file.readAll();
+    qint32 digit = data.indexOf(':', data.indexOf("\"sum\":{") + 7) + 1;
+    while (data.at(digit) < '1' || data.at(digit) > '8')
+        digit++;
+    data[digit] = data.at(digit) + 1;
+    QVERIFY(file.seek(0));
+    QCOMPARE(file.write(data), static_cast<qint64>(data.size()));
+    QVERIFY(file.flush());
+    QVERIFY(file.setFileTime(modified, QFileDevice::FileModificationTime));
+    file.close();
+    {
+        DataFetcher fresh;
+        fresh.setCacheDirectory(dir.filePath("cache"));
+        fresh.setSource(dir.filePath("a"));
+        QCOMPARE(fresh.check(target), uncached(dir.filePath("a")));
+    }
+}
+
+/*
+ * Three months of a personal chat, whose messages are length characters
+ * long and longer.
+ */
+QByteArray DataFetcherTest::chatExport(const QString &name, qint32 length)
+{
+    QByteArray res = "{\"name\":\"" + name.toUtf8() + "\",\"type\":\"personal_chat\",\"messages\":[";
+    for (qint32 m=0; m<3; m++)
+        for (qint32 i=0; i<5 + m; i++)
+        {
+            if (m || i) res += ',';
+            res += "{\"type\":\"message\",\"date\":\"2019-0" + QByteArray::number(m + 1) + "-1" + QByteArray::number(i) +
+                   "T10:00:00\",\"from_id\":\"user" + QByteArray::number(i % 2) + "\",\"text\":\"" + QByteArray(length + i, 'x') + "\"}";
+        }
+    res += "]}";
+    return res;
+}
+
+void DataFetcherTest::checkExport()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir().mkpath(dir.filePath("exports/Bob")));
+
+    // Named up to the first dot, or after the directory of an untouched
+    // result.json.
+    const QMap<QString, QByteArray> files = {
+        {"exports/Alice.json", chatExport("Alice", 5)},
+        {"exports/Alice.2.json", chatExport("Alice", 6)},
+        {"exports/Bob/result.json", chatExport("Bob", 40)},
+        {"unknown.json", chatExport("Unknown", 39)}
+    };
+    QMapIterator<QString, QByteArray> i(files);
+    while (i.hasNext())
+    {
+        i.next();
+        QFile file(dir.filePath(i.key()));
+        QVERIFY(file.open(QFile::WriteOnly));
+        QVERIFY(file.write(i.value()) > 0);
+    }
+
+    DataFetcher exports;
+    exports.setSource(dir.filePath("exports"));
+    QStringList labels;
+    for (const QVariant &v: exports.labels())
+        labels << v.toMap().value("label").toString();
+    labels.sort();
+    QCOMPARE(labels, QStringList({"Alice", "Bob"}));
+    for (const DataFetcher::Private::PropertyItem &pItem: exports.p->model->properties)
+        QVERIFY2(TelegramExportReader::properties().contains(pItem.property), qPrintable(pItem.property));
+
+    const QVariantMap res = exports.check(dir.filePath("unknown.json"));
+    QVERIFY2(!res.contains("error"), qPrintable(res.value("error").toString()));
+    QCOMPARE(res.value("result").toString(), QString("Bob"));
+
+    // Summaries name their properties differently, in both directions.
+    CorpusGenerator generator;
+    generator.files = 8;
+    generator.properties = 5;
+    QVERIFY(generator.generate(dir.filePath("summaries")));
+
+    DataFetcher summaries;
+    summaries.setSource(dir.filePath("summaries"));
+    QCOMPARE(summaries.check(dir.filePath("unknown.json")).value("error").toString(), QString("no known properties"));
+    QCOMPARE(exports.check(dir.filePath("summaries/" + generator.fileName(0))).value("error").toString(), QString("no known properties"));
+}
+
+void DataFetcherTest::singlePass_data()
+{
+    QTest::addColumn<qint32>("resolution");
+    QTest::addColumn<qint32>("distribution");
+    QTest::newRow("100 buckets, normal") << 100 << static_cast<qint32>(CorpusGenerator::Normal);
+    QTest::newRow("1000 buckets, normal") << 1000 << static_cast<qint32>(CorpusGenerator::Normal);
+    QTest::newRow("1000 buckets, exponential") << 1000 << static_cast<qint32>(CorpusGenerator::Exponential);
+}
+
+void DataFetcherTest::singlePass()
+{
+    QFETCH(qint32, resolution);
+    QFETCH(qint32, distribution);
+
+    CorpusGenerator generator;
+    generator.files = 60;
+    generator.properties = 10;
+    generator.distribution = static_cast<CorpusGenerator::Distribution>(distribution);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(generator.generate(dir.path()));
+
+    DataFetcher twoPass;
+    twoPass.setResolution(resolution);
+    twoPass.setSource(dir.path());
+
+    DataFetcher onePass;
+    onePass.setResolution(resolution);
+    onePass.setSinglePass(true);
+    onePass.setSource(dir.path());
+
+    const DataFetcher::Private::Model *expected = twoPass.p->model.data();
+    const DataFetcher::Private::Model *actual = onePass.p->model.data();
+    QVERIFY(actual->singlePass);
+    QCOMPARE(actual->items.count(), expected->items.count());
+    QCOMPARE(actual->properties.count(), expected->properties.count());
+
+    // Ranges and counts are exact. A histogram bucket lands in the bin of
+    // its mean as a whole, so the mass of every label is kept and only the
+    // buckets crossing a bin edge move, by one bin: the running sums of
+    // both functions stay close.
+    for (const DataFetcher::Private::PropertyItem &e: expected->properties)
+    {
+        const qint32 property = actual->propertyNames.id(e.property);
+        QVERIFY2(property >= 0, qPrintable(e.property));
+
+        const DataFetcher::Private::PropertyItem &a = actual->properties.at(property);
+        QCOMPARE(a.minimum, e.minimum);
+        QCOMPARE(a.maximum, e.maximum);
+        QCOMPARE(a.count, e.count);
+        QCOMPARE(a.resolution, e.resolution);
+        QCOMPARE(a.functions.isEmpty(), e.functions.isEmpty());
+        if (e.functions.isEmpty())
+            continue;
+
+        for (const DataFetcher::Private::PropertyLabel &eLabel: e.labels)
+        {
+            if (!eLabel.isValid())
+                continue;
+
+            const qint32 label = actual->labelNames.id(expected->items.at(eLabel.labelIndex).label);
+            QVERIFY(label >= 0 && a.contains(label));
+
+            const DataFetcher::Private::PropertyLabel &aLabel = a.labels.at(label);
+            QCOMPARE(aLabel.count(), eLabel.count());
+
+            const qreal *eFunction = eLabel.function(e);
+            const qreal *aFunction = aLabel.function(a);
+            qreal eSum = 0;
+            qreal aSum = 0;
+            qreal distance = 0;
+            for (qint32 i=0; i<e.resolution; i++)
+            {
+                eSum += eFunction[i];
+                aSum += aFunction[i];
+                distance = qMax(distance, qAbs(aSum - eSum));
+            }
+
+            QVERIFY2(qAbs(aSum - eSum) <= 1e-6 * qMax<qreal>(eSum, 1), qPrintable(e.property));
+            QVERIFY2(distance <= 0.05 * eSum, qPrintable(QString("%1: %2 of %3").arg(e.property).arg(distance).arg(eSum)));
+        }
+    }
+
+    // And they mostly agree on the files they were trained on.
+    qint32 agreed = 0;
+    for (qint32 i=0; i<generator.files; i++)
+    {
+        const QString path = dir.filePath(generator.fileName(i));
+        if (onePass.check(path).value("result") == twoPass.check(path).value("result"))
+            agreed++;
+    }
+    QVERIFY2(agreed >= generator.files * 9 / 10, qPrintable(QString("%1 of %2").arg(agreed).arg(generator.files)));
+}
+
+void DataFetcherTest::addResolutions()
+{
+    QTest::addColumn<qint32>("resolution");
+    QTest::addColumn<qint32>("density");
+
+    // The specialized kernels, the generic one and the bounds, each with
+    // sparse, dense and empty functions.
+    for (qint32 resolution: {MINIMUM_RESOLUTION, 64, 100, 1000, MAXIMUM_RESOLUTION})
+        for (qint32 density: {5, 90, 0})
+            QTest::newRow(QString("%1 buckets, %2%").arg(resolution).arg(density).toUtf8().constData()) << resolution << density;
+}
+
+void DataFetcherTest::fillFunction(DataFetcher::Private::PropertyItem *pItem, qint32 resolution, qint32 density)
+{
+    pItem->minimum = 0;
+    pItem->maximum = 1;
+    pItem->resolution = resolution;
+    pItem->labels.resize(1);
+    pItem->functions.resize(1, resolution);
+
+    DataFetcher::Private::PropertyLabel &pLabel = pItem->labels[0];
+    pLabel.labelIndex = 0;
+    pLabel.samples = 100;
+    pItem->count = pLabel.count();
+
+    qreal *function = pItem->functions.row(0);
+    for (qint32 i=0; i<resolution; i++)
+        function[i] = (qrand() % 100 < density? (qrand() % 1000 + 1) / 1000.0 : 0);
+
+    DataFetcher::Private::indexNeighbours(pLabel, function, resolution);
+    DataFetcher::Private::calculateScores(*pItem, pLabel);
+}
+
+qreal DataFetcherTest::valueAt(qint32 index, qint32 resolution)
+{
+    // Middle of the bucket, indexes are truncated towards zero.
+    return (index + (index < 0? -0.5 : 0.5)) / resolution;
+}
+
+/*
+ * calculateRate_1 as it was when the buckets were the keys of a map, so
+ * a bucket holding only values at the minimum still counted as occupied.
+ */
+qreal DataFetcherTest::mapRate(const QMap<qint32, qreal> &function, const DataFetcher::Private::PropertyItem &pItem, qint32 count, qreal value)
+{
+    qint32 index = ( (value - pItem.minimum) / (pItem.maximum - pItem.minimum) ) * pItem.resolution;
+    if (function.contains(index))
+        return function.value(index);
+
+    qint32 beforeIndex = -1;
+    qint32 afterIndex = pItem.resolution;
+
+    for (qint32 i=0; i<pItem.resolution; i++)
+    {
+        if (!function.contains(i))
+            continue;
+
+        if (i < index)
+            beforeIndex = i;
+        if (i > index)
+        {
+            afterIndex = i;
+            break;
+        }
+    }
+
+    qreal before = (beforeIndex == -1? pItem.minimum / count : function.value(beforeIndex));
+    qreal after = (afterIndex == pItem.resolution? pItem.minimum / count : function.value(afterIndex));
+
+    qreal difVal = qAbs(after - before);
+    qreal difIdx = (afterIndex - beforeIndex);
+    qreal ratio = difVal / difIdx;
+    return qMin(before, after) + (afterIndex - index) * ratio;
+}
+
+void DataFetcherTest::calculateRate_1_data()
+{
+    QTest::addColumn<qint32>("resolution");
+    QTest::addColumn<qint32>("density");
+    QTest::addColumn<qint32>("atMinimum");
+
+    for (qint32 resolution: {MINIMUM_RESOLUTION, 64, 100, 1000, MAXIMUM_RESOLUTION})
+        for (qint32 density: {5, 90})
+            for (qint32 atMinimum: {0, 3})
+                QTest::newRow(QString("%1 buckets, %2%, %3 at the minimum").arg(resolution).arg(density).arg(atMinimum).toUtf8().constData())
+                        << resolution << density << atMinimum;
+
+    QTest::newRow("only values at the minimum") << 100 << 0 << 3;
+}
+
+void DataFetcherTest::calculateRate_1()
+{
+    QFETCH(qint32, resolution);
+    QFETCH(qint32, density);
+    QFETCH(qint32, atMinimum);
+
+    // Trained from values, so the buckets go through calculateFunction
+    // like they do in a real model. The minimum isn't 0, the empty edges
+    // interpolate towards minimum / count.
+    DataFetcher::Private::PropertyItem pItem;
+    pItem.minimum = 2;
+    pItem.maximum = 10;
+    pItem.resolution = resolution;
+    pItem.labels.resize(1);
+
+    DataFetcher::Private::PropertyLabel &pLabel = pItem.labels[0];
+    pLabel.labelIndex = 0;
+    for (qint32 i=0; i<atMinimum; i++)
+        pLabel.values.append(pItem.minimum);
+    for (qint32 b=0; b<resolution; b++)
+        if (qrand() % 100 < density)
+            for (qint32 n=qrand() % 3; n>=0; n--)
+                pLabel.values.append(pItem.minimum + valueAt(b, resolution) * (pItem.maximum - pItem.minimum));
+    if (pLabel.values.isEmpty())
+        pLabel.values.append(pItem.minimum + valueAt(resolution / 2, resolution) * (pItem.maximum - pItem.minimum));
+
+    const qint32 count = pLabel.values.count();
+    pItem.count = count;
+    DataFetcher::Private::calculateFunction(pItem, pItem.labels.at(0));
+
+    QMap<qint32, qreal> function;
+    for (qint32 i=0; i<count; i++)
+    {
+        qreal normalValue = (pItem.labels.at(0).values.at(i) - pItem.minimum) / (pItem.maximum - pItem.minimum);
+        qint32 index = normalValue * resolution;
+        if (index == resolution) index--;
+
+        function[index] += (normalValue / count);
+    }
+
+    // Values a few buckets outside the range take the edge paths.
+    for (qint32 index=-3; index<resolution+3; index++)
+    {
+        const qreal value = pItem.minimum + valueAt(index, resolution) * (pItem.maximum - pItem.minimum);
+        QCOMPARE(pItem.index(value), index);
+        QCOMPARE(pItem.labels.at(0).calculateRate_1(pItem, value), mapRate(function, pItem, count, value));
+    }
+}
+
+void DataFetcherTest::calculateRate_2_data()
+{
+    addResolutions();
+}
+
+void DataFetcherTest::calculateRate_2()
+{
+    QFETCH(qint32, resolution);
+    QFETCH(qint32, density);
+
+    DataFetcher::Private::PropertyItem pItem;
+    fillFunction(&pItem, resolution, density);
+    const DataFetcher::Private::PropertyLabel &pLabel = pItem.labels.at(0);
+    const qreal *function = pLabel.function(pItem);
+
+    // The maximum falls on the extra row of the table.
+    for (qint32 index=-3; index<=resolution+3; index++)
+    {
+        const qreal value = (index == resolution? 1 : valueAt(index, resolution));
+        QCOMPARE(pItem.index(value), index);
+
+        qreal expected = 0;
+        for (qint32 i=0; i<resolution; i++)
+            expected += function[i] / qPow(qAbs(i - index) + 1, 4);
+
+        QCOMPARE(pLabel.calculateRate_2(pItem, value), expected);
+    }
+}
+
+QTEST_GUILESS_MAIN(DataFetcherTest)
+
+#include "datafetchertest.moc"
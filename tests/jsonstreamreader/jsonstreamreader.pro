@@ -0,0 +1,6 @@
+TARGET = jsonstreamreadertest
+
+include(../tests.pri)
+
+SOURCES += \
+    jsonstreamreadertest.cpp
@@ -0,0 +1,176 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include <QBuffer>
+#include <QJsonDocument>
+
+#include "jsonstreamreader.h"
+#include "corpusgenerator.h"
+
+typedef QMap<QString, QMap<QString, qreal> > MonthMap;
+
+/*
+ * Reads every document with the stream reader and with the QJsonDocument
+ * loader it replaced, which both have to agree on the label and on every
+ * (month, property, value).
+ */
+class JsonStreamReaderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void read_data();
+    void read();
+
+    void malformed_data();
+    void malformed();
+
+private:
+    static bool documentRead(const QByteArray &data, QString *label, MonthMap *months);
+};
+
+/*
+ * The non-streaming path of DataFetcher::Private::readMonths.
+ */
+bool JsonStreamReaderTest::documentRead(const QByteArray &data, QString *label, MonthMap *months)
+{
+    QVariantList list = QJsonDocument::fromJson(data).toVariant().toList();
+    if (list.isEmpty())
+        return false;
+
+    QVariantMap map = list.first().toMap();
+    *label = map.value("label").toString();
+
+    QVariantMap monthsMap = map.value("months").toMap();
+    QMapIterator<QString, QVariant> im(monthsMap);
+    while (im.hasNext())
+    {
+        im.next();
+        QVariantMap sum = im.value().toMap().value("sum").toMap();
+
+        QMapIterator<QString, QVariant> i(sum);
+        while (i.hasNext())
+        {
+            i.next();
+            switch (static_cast<qint32>(i.value().type()))
+            {
+            case QVariant::Map:
+            case QVariant::List:
+                continue;
+            }
+
+            bool ok = false;
+            qreal value = i.value().toReal(&ok);
+            if (!ok) continue;
+
+            (*months)[im.key()][i.key()] = value;
+        }
+    }
+
+    return true;
+}
+
+void JsonStreamReaderTest::read_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    CorpusGenerator generator;
+    generator.properties = 400; // Bigger than one chunk of the scanner
+    for (qint32 i=0; i<4; i++)
+        QTest::newRow(generator.fileName(i).toUtf8().constData()) << generator.file(i);
+
+    QTest::newRow("label after the months")
+            << QByteArray("[{\"months\":{\"2019-01\":{\"sum\":{\"a\":1,\"b\":2}}},\"label\":\"late\"}]");
+    QTest::newRow("no label")
+            << QByteArray("[{\"months\":{\"2019-01\":{\"sum\":{\"a\":1}}}}]");
+    QTest::newRow("escapes")
+            << QByteArray("[{\"label\":\"caf\\u00e9 \\\"\\/\\\\\",\"months\":{\"2019-01\":{\"sum\":{\"tab\\there\":1,\"\\u0633\":2}}}}]");
+    QTest::newRow("numbers")
+            << QByteArray("[{\"label\":\"n\",\"months\":{\"2019-01\":{\"sum\":{\"a\":-0.5,\"b\":1e3,\"c\":2.5E-2,\"d\":0,\"e\":123456789012}}}}]");
+    QTest::newRow("strings, booleans and null")
+            << QByteArray("[{\"label\":\"s\",\"months\":{\"2019-01\":{\"sum\":{\"a\":\"12.5\",\"b\":\"x\",\"c\":true,\"d\":false,\"e\":null}}}}]");
+    QTest::newRow("nested values")
+            << QByteArray("[{\"label\":\"v\",\"months\":{\"2019-01\":{\"sum\":{\"a\":{\"b\":1},\"c\":[1,2],\"d\":3}}}}]");
+    QTest::newRow("other members")
+            << QByteArray("[{\"id\":7,\"tags\":[\"x\",{\"label\":\"no\"}],\"label\":\"o\",\"months\":{\"2019-01\":{\"count\":{\"a\":9},\"sum\":{\"a\":1}},\"2019-02\":[]}}]");
+    QTest::newRow("only the first record")
+            << QByteArray("[{\"label\":\"first\",\"months\":{\"2019-01\":{\"sum\":{\"a\":1}}}},{\"label\":\"second\",\"months\":{\"2019-01\":{\"sum\":{\"a\":2}}}}]");
+    QTest::newRow("whitespace")
+            << QByteArray(" [ {\n\t\"label\" : \"w\" ,\r\n \"months\" : { \"2019-01\" : { \"sum\" : { \"a\" : 1 } } } } ] \n");
+}
+
+void JsonStreamReaderTest::read()
+{
+    QFETCH(QByteArray, data);
+
+    QString expectedLabel;
+    MonthMap expected;
+    QVERIFY(documentRead(data, &expectedLabel, &expected));
+
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    JsonStreamReader reader(&buffer);
+    MonthMap months;
+    bool labelled = true;
+    QVERIFY2(reader.read([&](const QString &label, const QString &month, const QString &property, qreal value){
+        labelled = labelled && label == reader.label();
+        months[month][property] = value;
+    }), qPrintable(reader.errorString()));
+
+    QVERIFY(reader.hasRecord());
+    QVERIFY(labelled);
+    QCOMPARE(reader.label(), expectedLabel);
+    QCOMPARE(months.keys(), expected.keys());
+    for (const QString &month: expected.keys())
+        QCOMPARE(months.value(month), expected.value(month));
+}
+
+void JsonStreamReaderTest::malformed_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("object") << QByteArray("{\"label\":\"x\"}");
+    QTest::newRow("truncated") << QByteArray("[{\"label\":\"x\",\"months\":{\"2019-01\":{\"sum\":{\"a\":1");
+    QTest::newRow("unterminated string") << QByteArray("[{\"label\":\"x");
+    QTest::newRow("bad escape") << QByteArray("[{\"label\":\"\\q\"}]");
+    QTest::newRow("bad number") << QByteArray("[{\"months\":{\"2019-01\":{\"sum\":{\"a\":1.2.3}}}}]");
+}
+
+void JsonStreamReaderTest::malformed()
+{
+    QFETCH(QByteArray, data);
+
+    // Neither side may accept it, the loader falls back on a failed read.
+    QString label;
+    MonthMap months;
+    QVERIFY(!documentRead(data, &label, &months));
+
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    JsonStreamReader reader(&buffer);
+    QVERIFY(!reader.read([](const QString &, const QString &, const QString &, qreal){}));
+    QVERIFY(!reader.errorString().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(JsonStreamReaderTest)
+
+#include "jsonstreamreadertest.moc"
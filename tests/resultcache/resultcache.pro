@@ -0,0 +1,6 @@
+TARGET = resultcachetest
+
+include(../tests.pri)
+
+SOURCES += \
+    resultcachetest.cpp
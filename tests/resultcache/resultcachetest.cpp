@@ -0,0 +1,161 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+
+#include "resultcache.h"
+
+/*
+ * Hits and misses of both tiers, and what invalidate() and the disk tier
+ * may touch.
+ */
+class ResultCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void memory();
+    void disabled();
+    void disk();
+    void invalidate();
+
+private:
+    static QVariantMap entry(const QString &result);
+};
+
+QVariantMap ResultCacheTest::entry(const QString &result)
+{
+    return { {"result", result}, {"rates", QVariantMap({ {result, 50.5} })} };
+}
+
+void ResultCacheTest::memory()
+{
+    ResultCache cache;
+    cache.setCapacity(2);
+    QVERIFY(cache.isEnabled());
+
+    const QByteArray version("v1");
+    cache.insert(version, "a", entry("a"));
+    cache.insert(version, "b", entry("b"));
+
+    // Touching a makes b the least recently used one.
+    QVariantMap value;
+    bool disk = true;
+    QVERIFY(cache.find(version, "a", &value, &disk));
+    QCOMPARE(value, entry("a"));
+    QVERIFY(!disk);
+
+    cache.insert(version, "c", entry("c"));
+    QVERIFY(!cache.find(version, "b", &value));
+    QVERIFY(cache.find(version, "a", &value));
+    QVERIFY(cache.find(version, "c", &value));
+    QCOMPARE(value, entry("c"));
+    QVERIFY(!cache.find(version, "d", &value));
+}
+
+void ResultCacheTest::disabled()
+{
+    ResultCache cache;
+    cache.setCapacity(0);
+    QVERIFY(!cache.isEnabled());
+
+    QVariantMap value;
+    cache.insert("v1", "a", entry("a"));
+    QVERIFY(!cache.find("v1", "a", &value));
+}
+
+void ResultCacheTest::disk()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Whatever else the directory holds stays as it is.
+    {
+        QFile file(dir.filePath("notes.txt"));
+        QVERIFY(file.open(QFile::WriteOnly));
+        QVERIFY(file.write("mine") > 0);
+    }
+
+    {
+        ResultCache cache;
+        cache.setCapacity(0);
+        cache.setDirectory(dir.path());
+        QVERIFY(cache.isEnabled());
+        cache.insert("v1", "a", entry("a"));
+        cache.insert(QByteArray(), "b", entry("b"));
+    }
+
+    QCOMPARE(QDir(dir.path()).entryList(QDir::AllEntries | QDir::NoDotAndDotDot), QStringList({"notes.txt", "tganalizer-results"}));
+    QVERIFY(QFile::exists(dir.filePath("tganalizer-results/CACHEDIR.TAG")));
+    QVERIFY(QFile::exists(dir.filePath("tganalizer-results/" + QString::fromLatin1(QByteArray("v1").toHex()) + "/" +
+                                       QString::fromLatin1(QByteArray("a").toHex()) + ".json")));
+    QVERIFY(QFile::exists(dir.filePath("tganalizer-results/untrained/" + QString::fromLatin1(QByteArray("b").toHex()) + ".json")));
+
+    // A new cache over the same directory finds them on disk, under their
+    // own version only.
+    ResultCache cache;
+    cache.setDirectory(dir.path());
+
+    QVariantMap value;
+    bool disk = false;
+    QVERIFY(cache.find("v1", "a", &value, &disk));
+    QCOMPARE(value, entry("a"));
+    QVERIFY(disk);
+    QVERIFY(cache.find(QByteArray(), "b", &value, &disk));
+    QCOMPARE(value, entry("b"));
+    QVERIFY(!cache.find("v2", "a", &value));
+
+    // Found on disk, then kept in memory.
+    QVERIFY(cache.find("v1", "a", &value, &disk));
+    QVERIFY(!disk);
+
+    QFile notes(dir.filePath("notes.txt"));
+    QVERIFY(notes.open(QFile::ReadOnly));
+    QCOMPARE(notes.readAll(), QByteArray("mine"));
+}
+
+void ResultCacheTest::invalidate()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    ResultCache cache;
+    cache.setDirectory(dir.path());
+    cache.insert("v1", "a", entry("a"));
+    cache.insert("v2", "b", entry("b"));
+
+    // Memory only: the entry comes back from its file.
+    QVariantMap value;
+    bool disk = false;
+    cache.invalidate("v1", false);
+    QVERIFY(cache.find("v1", "a", &value, &disk));
+    QVERIFY(disk);
+
+    // With the files, of that version alone.
+    cache.invalidate("v1", true);
+    QVERIFY(!cache.find("v1", "a", &value));
+    QVERIFY(cache.find("v2", "b", &value, &disk));
+    QVERIFY(disk);
+}
+
+QTEST_GUILESS_MAIN(ResultCacheTest)
+
+#include "resultcachetest.moc"
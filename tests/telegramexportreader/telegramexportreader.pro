@@ -0,0 +1,6 @@
+TARGET = telegramexportreadertest
+
+include(../tests.pri)
+
+SOURCES += \
+    telegramexportreadertest.cpp
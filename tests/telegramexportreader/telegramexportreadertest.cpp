@@ -0,0 +1,161 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include <QBuffer>
+
+#include "telegramexportreader.h"
+
+typedef QMap<QString, QMap<QString, qreal> > MonthMap;
+
+/*
+ * Folds small hand written exports and compares every monthly property
+ * with the counts worked out by hand.
+ */
+class TelegramExportReaderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void singleChat();
+    void wholeAccount();
+    void noChat();
+    void truncated();
+
+private:
+    static bool fold(TelegramExportReader *reader, MonthMap *months);
+    static QMap<QString, qreal> month(const QMap<QString, qreal> &counts);
+};
+
+bool TelegramExportReaderTest::fold(TelegramExportReader *reader, MonthMap *months)
+{
+    // Every property of every month is reported, without a label.
+    bool labelled = false;
+    const bool ok = reader->read([months, &labelled](const QString &label, const QString &month, const QString &property, qreal value){
+        labelled = labelled || !label.isEmpty();
+        (*months)[month][property] = value;
+    });
+    return ok && !labelled;
+}
+
+QMap<QString, qreal> TelegramExportReaderTest::month(const QMap<QString, qreal> &counts)
+{
+    QMap<QString, qreal> res;
+    for (const QString &property: TelegramExportReader::properties())
+        res[property] = counts.value(property);
+    return res;
+}
+
+void TelegramExportReaderTest::singleChat()
+{
+    QByteArray data =
+        "{\n"
+        " \"name\": \"Alice\",\n"
+        " \"type\": \"personal_chat\",\n"
+        " \"id\": 1,\n"
+        " \"messages\": [\n"
+        "  {\"id\": 1, \"type\": \"message\", \"date\": \"2019-01-05T02:10:00\", \"from\": \"Alice\", \"from_id\": \"user1\", \"text\": \"Hi there?\"},\n"
+        "  {\"id\": 2, \"type\": \"message\", \"date\": \"2019-01-05T12:00:00\", \"from\": \"Bob\", \"from_id\": \"user2\", \"reply_to_message_id\": 1,\n"
+        "   \"edited\": \"2019-01-05T12:01:00\", \"text\": [\"see \", {\"type\": \"link\", \"text\": \"http://a.io\"}, \" ok\"]},\n"
+        "  {\"id\": 3, \"type\": \"message\", \"date\": \"2019-01-20T13:00:00\", \"from_id\": \"user1\", \"photo\": \"photos/1.jpg\", \"text\": \"\"},\n"
+        "  {\"id\": 4, \"type\": \"service\", \"date\": \"2019-01-21T10:00:00\", \"actor_id\": \"user2\", \"action\": \"phone_call\", \"duration_seconds\": 65},\n"
+        "  {\"id\": 5, \"type\": \"message\", \"date\": \"2019-02-01T23:00:00\", \"from_id\": 2, \"file\": \"stickers/1.webp\", \"media_type\": \"sticker\", \"text\": \"\"},\n"
+        "  {\"id\": 6, \"type\": \"message\", \"date\": \"2019-02-02T08:00:00\", \"from_id\": 1, \"forwarded_from\": \"Carol\", \"file\": \"voice/1.ogg\",\n"
+        "   \"media_type\": \"voice_message\", \"text\": \"\\u0633\\u0644\\u0627\\u0645 \\u061f\"}\n"
+        " ]\n"
+        "}\n";
+
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    TelegramExportReader reader(&buffer);
+    MonthMap months;
+    QVERIFY2(fold(&reader, &months), qPrintable(reader.errorString()));
+
+    QVERIFY(reader.hasChat());
+    QCOMPARE(reader.chatName(), QString("Alice"));
+    QCOMPARE(months.keys(), QStringList({"2019-01", "2019-02"}));
+
+    // The call counts towards calls only, not messages, days or senders.
+    QCOMPARE(months.value("2019-01"), month({ {"messages", 3}, {"characters", 9 + 4 + 11 + 3}, {"words", 2 + 3},
+                                              {"questions", 1}, {"links", 1}, {"photos", 1}, {"replies", 1}, {"edited", 1},
+                                              {"calls", 1}, {"call seconds", 65}, {"night messages", 1},
+                                              {"active days", 2}, {"senders", 2} }));
+    QCOMPARE(months.value("2019-02"), month({ {"messages", 2}, {"characters", 6}, {"words", 2}, {"questions", 1},
+                                              {"stickers", 1}, {"voice messages", 1}, {"forwards", 1},
+                                              {"active days", 2}, {"senders", 2} }));
+}
+
+void TelegramExportReaderTest::wholeAccount()
+{
+    // The first personal chat is read, groups before it are skipped.
+    QByteArray data =
+        "{\"about\": \"export\", \"personal_information\": {\"first_name\": \"Me\"},\n"
+        " \"chats\": {\"about\": \"chats\", \"list\": [\n"
+        "  {\"name\": \"Group\", \"type\": \"private_group\", \"id\": 2, \"messages\": [\n"
+        "   {\"id\": 1, \"type\": \"message\", \"date\": \"2020-03-01T10:00:00\", \"from_id\": \"user9\", \"text\": \"group\"}]},\n"
+        "  {\"name\": \"Bob\", \"type\": \"personal_chat\", \"id\": 3, \"messages\": [\n"
+        "   {\"id\": 1, \"type\": \"message\", \"date\": \"2020-03-04T10:00:00\", \"from_id\": \"user3\", \"text\": \"hello world\"}]},\n"
+        "  {\"name\": \"Carol\", \"type\": \"personal_chat\", \"id\": 4, \"messages\": [\n"
+        "   {\"id\": 1, \"type\": \"message\", \"date\": \"2020-04-04T10:00:00\", \"from_id\": \"user4\", \"text\": \"other\"}]}\n"
+        " ]}}\n";
+
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    TelegramExportReader reader(&buffer);
+    MonthMap months;
+    QVERIFY2(fold(&reader, &months), qPrintable(reader.errorString()));
+
+    QVERIFY(reader.hasChat());
+    QCOMPARE(reader.chatName(), QString("Bob"));
+    QCOMPARE(months.keys(), QStringList({"2020-03"}));
+    QCOMPARE(months.value("2020-03"), month({ {"messages", 1}, {"characters", 11}, {"words", 2},
+                                              {"active days", 1}, {"senders", 1} }));
+}
+
+void TelegramExportReaderTest::noChat()
+{
+    QByteArray data("{\"about\": \"export\", \"contacts\": {\"list\": []}}");
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    TelegramExportReader reader(&buffer);
+    MonthMap months;
+    QVERIFY(fold(&reader, &months));
+
+    QVERIFY(!reader.hasChat());
+    QVERIFY(months.isEmpty());
+}
+
+void TelegramExportReaderTest::truncated()
+{
+    QByteArray data("{\"name\": \"Alice\", \"type\": \"personal_chat\", \"messages\": [{\"id\": 1, \"type\": \"mess");
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    TelegramExportReader reader(&buffer);
+    MonthMap months;
+    QVERIFY(!fold(&reader, &months));
+
+    QVERIFY(!reader.errorString().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TelegramExportReaderTest)
+
+#include "telegramexportreadertest.moc"
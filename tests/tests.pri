@@ -0,0 +1,6 @@
+QT = core testlib
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+include(../core/core.pri)
+include(../testsupport/testsupport.pri)
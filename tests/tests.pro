@@ -0,0 +1,7 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    datafetcher \
+    jsonstreamreader \
+    resultcache \
+    telegramexportreader
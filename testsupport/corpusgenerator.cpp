@@ -0,0 +1,145 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "corpusgenerator.h"
+
+#include <QDir>
+#include <QFile>
+#include <QtMath>
+
+namespace {
+
+// splitmix64, so the corpus doesn't depend on the standard library's
+// random engines and distributions, which differ between platforms.
+class Random
+{
+public:
+    Random(quint64 seed) : state(seed) {}
+
+    quint64 next() {
+        quint64 z = (state += Q_UINT64_C(0x9E3779B97F4A7C15));
+        z = (z ^ (z >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+        z = (z ^ (z >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+        return z ^ (z >> 31);
+    }
+
+    qreal uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    quint64 state;
+};
+
+}
+
+CorpusGenerator::CorpusGenerator()
+{
+}
+
+bool CorpusGenerator::generate(const QString &directory, qint64 *bytes) const
+{
+    QDir dir(directory);
+    if (!dir.mkpath("."))
+        return false;
+
+    qint64 total = 0;
+    for (qint32 i=0; i<files; i++)
+    {
+        QFile f(dir.filePath(fileName(i)));
+        if (!f.open(QFile::WriteOnly))
+            return false;
+
+        const QByteArray data = file(i);
+        if (f.write(data) != data.size())
+            return false;
+
+        total += data.size();
+    }
+
+    if (bytes)
+        *bytes = total;
+    return true;
+}
+
+QByteArray CorpusGenerator::file(qint32 index) const
+{
+    const qint32 label = index % labels;
+    Random random(seed ^ (static_cast<quint64>(index) * Q_UINT64_C(0xD6E8FEB86659FD93)));
+
+    QByteArray res;
+    res.reserve(64 + months * (32 + properties * 24));
+    res += "[{\"label\":\"label";
+    res += QByteArray::number(label);
+    res += "\",\"months\":{";
+
+    for (qint32 m=0; m<months; m++)
+    {
+        if (m) res += ',';
+        res += "\"" + QByteArray::number(2019 + m/12) + "-" + QByteArray::number(m%12 + 1).rightJustified(2, '0') + "\":{\"sum\":{";
+
+        for (qint32 p=0; p<properties; p++)
+        {
+            // The center of a (label, property) pair is fixed by the seed alone.
+            Random centers(seed ^ (static_cast<quint64>(label) << 32) ^ static_cast<quint64>(p));
+            const qreal center = 10 + centers.uniform() * 90;
+            const qreal spread = center / 4;
+
+            qreal value = 0;
+            switch (distribution)
+            {
+            case Uniform:
+                value = center + (random.uniform() - 0.5) * 2 * spread;
+                break;
+            case Normal:
+            {
+                const qreal u1 = qMax(random.uniform(), 1e-12);
+                const qreal u2 = random.uniform();
+                value = center + qSqrt(-2 * qLn(u1)) * qCos(2 * M_PI * u2) * spread;
+                break;
+            }
+            case Exponential:
+                value = -qLn(qMax(1 - random.uniform(), 1e-12)) * center;
+                break;
+            }
+
+            if (p) res += ',';
+            res += "\"property" + QByteArray::number(p) + "\":" + QByteArray::number(qRound(qMax<qreal>(value, 0)));
+        }
+
+        res += "}}";
+    }
+
+    res += "}}]";
+    return res;
+}
+
+QString CorpusGenerator::fileName(qint32 index) const
+{
+    return QString("chat%1.json").arg(index, 6, 10, QChar('0'));
+}
+
+QStringList CorpusGenerator::labelNames() const
+{
+    QStringList res;
+    for (qint32 i=0; i<labels; i++)
+        res << QString("label%1").arg(i);
+    return res;
+}
+
+CorpusGenerator::~CorpusGenerator()
+{
+}
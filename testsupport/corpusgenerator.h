@@ -0,0 +1,59 @@
+/*
+    Copyright (C) 2019 Aseman Team
+    http://aseman.io
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORPUSGENERATOR_H
+#define CORPUSGENERATOR_H
+
+#include <QString>
+#include <QStringList>
+
+/*!
+ * Writes a synthetic training directory in the exported chat summary
+ * format. The output only depends on the parameters and the seed, so
+ * every run of a benchmark sees byte for byte the same corpus.
+ *
+ * File i belongs to label i % labels. Every (label, property) pair has
+ * its own center, so the labels are separable the way real chats are.
+ */
+class CorpusGenerator
+{
+public:
+    enum Distribution {
+        Uniform,
+        Normal,
+        Exponential
+    };
+
+    CorpusGenerator();
+    virtual ~CorpusGenerator();
+
+    qint32 labels = 4;
+    qint32 files = 100;
+    qint32 months = 12;
+    qint32 properties = 50;
+    Distribution distribution = Normal;
+    quint64 seed = 1601353213;
+
+    bool generate(const QString &directory, qint64 *bytes = Q_NULLPTR) const;
+
+    QByteArray file(qint32 index) const;
+    QString fileName(qint32 index) const;
+    QStringList labelNames() const;
+};
+
+#endif // CORPUSGENERATOR_H
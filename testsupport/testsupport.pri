@@ -0,0 +1,8 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/corpusgenerator.cpp
+
+HEADERS += \
+    $$PWD/corpusgenerator.h